@@ -54,6 +54,11 @@ CMN_INCFLAGS := -I$(TOPDIR)/common/include
 ifeq ($(BUILD_FOR_GBBOOT_SERVER),1)
 CMN_CSRC =  $(CMN_SRCDIR)/gbboot_server_start.c
 CMN_CSRC += $(CMN_SRCDIR)/gbboot_fake_svc.c
+else ifeq ($(BUILD_FOR_BENCH),1)
+CMN_CSRC =  $(CMN_SRCDIR)/bench.c
+else ifeq ($(BUILD_FOR_AUDIT),1)
+# The chip's host_audit.c takes the place of start.c
+CMN_CSRC =
 else
 ifeq ($(BOOT_STAGE), 3)
 CMN_CSRC =  $(CMN_SRCDIR)/3rdstage_start.c
@@ -69,13 +74,18 @@ CMN_CSRC += $(CMN_SRCDIR)/unipro.c
 CMN_CSRC += $(CMN_SRCDIR)/gbcore.c
 CMN_CSRC += $(CMN_SRCDIR)/debug.c
 CMN_CSRC += $(CMN_SRCDIR)/gbboot.c
+ifeq ($(CONFIG_BOOT_TIMELINE),y)
+CMN_CSRC += $(CMN_SRCDIR)/timeline.c
+endif
+CMN_CSRC += $(CMN_SRCDIR)/trace.c
+CMN_CSRC += $(CMN_SRCDIR)/capture.c
 
 CMN_ASRC =
 
 CSRC = $(CHIP_CSRC) $(CMN_CSRC) $(ARCH_EXTRA_CSRC)
 ASRC = $(CHIP_ASRC) $(CMN_ASRC) $(ARCH_EXTRA_ASRC)
 
-SRCDIRS := $(CHIP_SRCDIR) $(CMN_SRCDIR) $(ARCH_EXTRA_SRCDIR) $(MANIFEST_SRCDIR)
+SRCDIRS := $(CHIP_SRCDIR) $(CHIP_SHARED_SRCDIR) $(CMN_SRCDIR) $(ARCH_EXTRA_SRCDIR) $(MANIFEST_SRCDIR)
 
 COBJS := $(foreach f, $(CSRC), $(OUTROOT)/$(patsubst %.c,%.o, $(f)))
 AOBJS := $(foreach f, $(ASRC), $(OUTROOT)/$(patsubst %.S,%.o, $(f)))
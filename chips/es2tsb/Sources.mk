@@ -32,4 +32,7 @@ ARCH_EXTRA_CSRC = $(ARCH_EXTRA_SRCDIR)/es2_spi.c
 ARCH_EXTRA_CSRC += $(ARCH_EXTRA_SRCDIR)/es2_unipro.c
 ARCH_EXTRA_CSRC += $(ARCH_EXTRA_SRCDIR)/es2_efuse.c
 ARCH_EXTRA_CSRC += $(ARCH_EXTRA_SRCDIR)/es2_advertise.c
+ifeq ($(BUILD_FOR_BENCH),1)
+ARCH_EXTRA_CSRC += $(ARCH_EXTRA_SRCDIR)/es2_bench.c
+endif
 ARCH_EXTRA_ASRC = $(ARCH_EXTRA_SRCDIR)/es2_standby.S
@@ -61,6 +61,17 @@ void chip_advertise_boot_status(uint32_t boot_status) {
     }
 }
 
+/**
+ * @brief publish boot metrics
+ *
+ * ES2 has no spare DME attributes to hold them, so they are only available
+ * in the communication area.
+ * @return 0
+ */
+int chip_advertise_boot_metrics(const uint32_t *metrics, unsigned int count) {
+    return 0;
+}
+
 /**
  * @brief advertise the boot type
  * @param result_code destination for advertisement result
@@ -166,16 +166,16 @@ static int es2_fixup_mphy(void)
      */
     urc = unipro_attr_local_write(TSB_MPHY_MAP, TSB_MPHY_MAP_TSB_REGISTER_2, 0);
     if (urc) {
-        dbgprint((char*)__func__);
-        dbgprintx32(": failed to switch to register 2 map:", urc, "\n");
+        dbgprintx32("es2_fixup_mphy: failed to switch to register 2 map:",
+                    urc, "\n");
         return urc;
     }
     fu = tsb_register_2_map_mphy_fixups;
     do {
         urc = unipro_attr_local_write(fu->attrid, fu->value, fu->select_index);
         if (urc) {
-            dbgprint((char*)__func__);
-            dbgprintx32(": failed to switch to register 2 map:", urc, "\n");
+            dbgprintx32("es2_fixup_mphy: failed to switch to register 2 map:",
+                        urc, "\n");
             return urc;
         }
     } while (!tsb_mphy_fixup_is_last(fu++));
@@ -185,8 +185,8 @@ static int es2_fixup_mphy(void)
      */
     urc = unipro_attr_local_write(TSB_MPHY_MAP, TSB_MPHY_MAP_NORMAL, 0);
     if (urc) {
-        dbgprint((char*)__func__);
-        dbgprintx32(": failed to switch to normal map: ", urc, "\n");
+        dbgprintx32("es2_fixup_mphy: failed to switch to normal map: ",
+                    urc, "\n");
         return urc;
     }
 
@@ -195,8 +195,8 @@ static int es2_fixup_mphy(void)
      */
     urc = unipro_attr_local_write(TSB_MPHY_MAP, TSB_MPHY_MAP_TSB_REGISTER_1, 0);
     if (urc) {
-        dbgprint((char*)__func__);
-        dbgprintx32(": failed to switch to register 1 map: ", urc, "\n");
+        dbgprintx32("es2_fixup_mphy: failed to switch to register 1 map: ",
+                    urc, "\n");
         return urc;
     }
     fu = tsb_register_1_map_mphy_fixups;
@@ -212,8 +212,8 @@ static int es2_fixup_mphy(void)
                                           fu->select_index);
         }
         if (urc) {
-            dbgprint((char*)__func__);
-            dbgprintx32(": failed to switch to register 1 map: ", urc, "\n");
+            dbgprintx32("es2_fixup_mphy: failed to switch to register 1 map: ",
+                        urc, "\n");
             return urc;
         }
     } while (!tsb_mphy_fixup_is_last(fu++));
@@ -223,8 +223,8 @@ static int es2_fixup_mphy(void)
      */
     urc = unipro_attr_local_write(TSB_MPHY_MAP, TSB_MPHY_MAP_NORMAL, 0);
     if (urc) {
-        dbgprint((char*)__func__);
-        dbgprintx32(": failed to switch to normal map: ", urc, "\n");
+        dbgprintx32("es2_fixup_mphy: failed to switch to normal map: ",
+                    urc, "\n");
         return urc;
     }
 
@@ -295,7 +295,7 @@ void chip_unipro_init(void) {
     tsb_unipro_write(UNIPRO_INT_EN, 0);
     tsb_unipro_write(UNIPRO_INT_EN, 1);
 
-    tsb_reset_all_cports();
+    tsb_reset_cports_in_use();
     dbgprint("Unipro enabled!\n");
 }
 
@@ -324,6 +324,38 @@ int chip_unipro_attr_write(uint16_t attr, uint32_t val, uint16_t selector,
     return unipro_attr_access(attr, &val, selector, peer, 1);
 }
 
+int chip_unipro_attr_access_batch(struct unipro_attr_req *reqs,
+                                  unsigned int count) {
+    unsigned int i;
+    int rc;
+
+    rc = tsb_unipro_attr_access_batch(reqs, count);
+    if (rc) {
+        return rc;
+    }
+
+    /* Keep the VID/PID substitution done by chip_unipro_attr_read */
+    for (i = 0; i < count; i++) {
+        if (reqs[i].write) {
+            continue;
+        }
+        if (reqs[i].attr == DME_DDBL2_VID) {
+            reqs[i].val = DME_DDBL2_DUMMY_VID;
+        } else if (reqs[i].attr == DME_DDBL2_PID) {
+            reqs[i].val = DME_DDBL2_DUMMY_PID;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief ES2 downloads in the mode the link comes up in
+ */
+int chip_unipro_change_power_mode(void) {
+    return 0;
+}
+
 /**
  * @brief send data down a CPort
  * @param cportid cport to send down
@@ -359,55 +391,14 @@ int chip_unipro_send(unsigned int cportid, const void *buf, size_t len) {
 }
 
 int chip_unipro_receive(unsigned int cportid, unipro_rx_handler handler) {
-    uint32_t bytes_received;
-    struct cport *cport;
-
-    uint32_t eom_nom_bit;
-    uint32_t eom_err_bit;
-    uint32_t eot_bit;
-
-    uint32_t eom;
-    uint32_t eot;
-
-    cport = cport_handle(cportid);
-    if (!cport) {
-        return -1;
-    }
+    struct unipro_rx_dispatch rx = {cportid, handler};
 
-    while(1) {
-        eom = tsb_unipro_read(AHM_RX_EOM_INT_BEF_0);
-        eot = tsb_unipro_read(AHM_RX_EOT_INT_BEF_0);
-
-        eom_nom_bit = (0x01 << (cportid << 1));
-        eom_err_bit = (0x10 << (cportid << 1));
-        eot_bit = (1 << cportid);
+    return tsb_unipro_receive_any(&rx, 1) < 0 ? -1 : 0;
+}
 
-        if ((eom & eom_err_bit) != 0) {
-            dbgprint("UniPro RX error\n");
-            return -1;
-        }
-        if ((eot & eot_bit) != 0) {
-            dbgprint("data received exceeded max length\n");
-            return -1;
-        }
-        if ((eom & eom_nom_bit) != 0) {
-            bytes_received = tsb_unipro_read(CPB_RX_TRANSFERRED_DATA_SIZE_00 +
-                                             (cportid << 2));
-            tsb_unipro_write(AHM_RX_EOM_INT_BEF_0, eom_nom_bit);
-
-            if (handler != NULL) {
-                if(0 != handler(cportid,
-                                cport->rx_buf,
-                                bytes_received)) {
-                    dbgprint("RX handler returned error\n");
-                    return -1;
-                }
-            }
-            tsb_unipro_restart_rx(cport);
-            return 0;
-        }
-    }
-    return 0;
+int chip_unipro_receive_any(const struct unipro_rx_dispatch *rx,
+                            unsigned int count) {
+    return tsb_unipro_receive_any(rx, count);
 }
 
 int chip_unipro_init_cport(uint32_t cportid) {
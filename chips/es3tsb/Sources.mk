@@ -33,5 +33,8 @@ ARCH_EXTRA_CSRC += $(ARCH_EXTRA_SRCDIR)/es3_efuse.c
 ARCH_EXTRA_CSRC += $(ARCH_EXTRA_SRCDIR)/es3_spi.c
 ARCH_EXTRA_CSRC += $(ARCH_EXTRA_SRCDIR)/es3_advertise.c
 ARCH_EXTRA_CSRC += $(ARCH_EXTRA_SRCDIR)/es3_workram_standby.c
+ifeq ($(BUILD_FOR_BENCH),1)
+ARCH_EXTRA_CSRC += $(ARCH_EXTRA_SRCDIR)/es3_bench.c
+endif
 
 ARCH_EXTRA_ASRC = $(ARCH_EXTRA_SRCDIR)/es3_standby.S
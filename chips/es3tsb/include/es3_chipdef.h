@@ -37,7 +37,12 @@
 #define SPI_BASE        (0x40018000)
 #define SPI_SIZE        (0x800)
 
+/* Spare words between DME_DDBL2_ENDPOINTID_L and MBOX_ACK_ATTR */
+#define ES3_SYSTEM_STATUS_4     0x6104
+#define ES3_SYSTEM_STATUS_14    0x610e
 #define ES3_SYSTEM_STATUS_15    0x610f
+#define BOOT_METRICS_ATTR       ES3_SYSTEM_STATUS_4
+#define BOOT_METRICS_MAX_WORDS  (ES3_SYSTEM_STATUS_14 - ES3_SYSTEM_STATUS_4 + 1)
 #define MBOX_ACK_ATTR           ES3_SYSTEM_STATUS_15
 
 #endif
\ No newline at end of file
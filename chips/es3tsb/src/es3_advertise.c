@@ -33,6 +33,11 @@
 #include "chipapi.h"
 #include "common.h"
 #include "bootrom.h"
+#include "timeline.h"
+
+/* Compile-time test that the metrics fit in the spare attributes */
+typedef char ___boot_metrics_test[(NUMBER_OF_BOOT_METRICS <=
+                                   BOOT_METRICS_MAX_WORDS) ? 1 : -1];
 
 uint32_t boot_status_offline = 0;
 
@@ -61,6 +66,31 @@ void chip_advertise_boot_status(uint32_t boot_status) {
     }
 }
 
+/**
+ * @brief publish boot metrics in the spare system status attributes
+ * @param metrics the BOOT_METRICS_xxx words
+ * @param count number of words
+ * @return 0 on success, <0 on internal error, >0 on UniPro error
+ */
+int chip_advertise_boot_metrics(const uint32_t *metrics, unsigned int count) {
+    struct unipro_attr_req reqs[BOOT_METRICS_MAX_WORDS];
+    unsigned int i;
+
+    if (count > BOOT_METRICS_MAX_WORDS) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < count; i++) {
+        reqs[i].attr = BOOT_METRICS_ATTR + i;
+        reqs[i].selector = 0;
+        reqs[i].val = metrics[i];
+        reqs[i].peer = ATTR_LOCAL;
+        reqs[i].write = 1;
+    }
+
+    return chip_unipro_attr_access_batch(reqs, count);
+}
+
 /**
  * @brief advertise the boot type
  * @param result_code destination for advertisement result
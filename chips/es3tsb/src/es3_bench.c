@@ -0,0 +1,64 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * ES3 e-Fuse kernels for "make bench". A private copy of es3_efuse.c gives
+ * access to its static helpers; its exported functions are renamed to keep
+ * out of the way of the copy the boot uses.
+ */
+#define efuse_init                  bench_efuse_init
+#define efuse_rig_for_untrusted     bench_efuse_rig_for_untrusted
+#include "es3_efuse.c"
+#undef efuse_init
+#undef efuse_rig_for_untrusted
+
+#include "bench.h"
+
+/* As read from the IMS e-Fuses: words, then a tail of single bytes */
+static uint32_t bench_ims[(TSB_ISAA_NUM_IMS_BYTES + 3) / 4];
+
+static volatile uint32_t bench_efuse_sink;
+
+static void bench_count_ones(void) {
+    bench_efuse_sink = count_ones((uint8_t *)bench_ims,
+                                  TSB_ISAA_NUM_IMS_BYTES);
+}
+
+static void bench_valid_hamming_weight(void) {
+    bench_efuse_sink = valid_hamming_weight((uint8_t *)bench_ims,
+                                            IMS_MEANINGFUL_LENGTH);
+}
+
+void bench_chip_kernels(void) {
+    /* Half the bits set: the weight a programmed field has */
+    memset(bench_ims, 0x0F, TSB_ISAA_NUM_IMS_BYTES);
+
+    BENCH("count_ones", "byte", TSB_ISAA_NUM_IMS_BYTES, 256,
+          bench_count_ones);
+    BENCH("valid_hamming_weight", "op", 1, 256, bench_valid_hamming_weight);
+}
@@ -46,6 +46,7 @@
 #include "unipro.h"
 #include "efuse.h"
 #include "crypto.h"
+#include "utils.h"
 
 
 /* Mask values used by "count_ones" */
@@ -151,15 +152,16 @@ int efuse_init(void) {
             return -1;
         }
     } else {
+        struct unipro_attr_req endpoint_reqs[] = {
+            UNIPRO_ATTR_WRITE(DME_DDBL2_ENDPOINTID_L, 0, endpoint_id.low,
+                              ATTR_LOCAL),
+            UNIPRO_ATTR_WRITE(DME_DDBL2_ENDPOINTID_H, 0, endpoint_id.high,
+                              ATTR_LOCAL),
+        };
+
         dbgprintx64("efuse_init: endpoint ID: ", endpoint_id.quad, "\n");
-        urc = chip_unipro_attr_write(DME_DDBL2_ENDPOINTID_L, endpoint_id.low, 0,
-                                ATTR_LOCAL);
-        if (urc) {
-            set_last_error(BRE_EFUSE_ENDPOINT_ID_WRITE);
-            return -1;
-        }
-        urc = chip_unipro_attr_write(DME_DDBL2_ENDPOINTID_H, endpoint_id.high,
-                                0, ATTR_LOCAL);
+        urc = chip_unipro_attr_access_batch(endpoint_reqs,
+                                            ARRAY_SIZE(endpoint_reqs));
         if (urc) {
             set_last_error(BRE_EFUSE_ENDPOINT_ID_WRITE);
             return -1;
@@ -27,11 +27,14 @@
  */
 
 #include <stddef.h>
+#include <errno.h>
 #include "chipapi.h"
 #include "tsb_unipro.h"
 #include "debug.h"
+#include "utils.h"
 #include "data_loading.h"
 #include "greybus.h"
+#include "timeline.h"
 
 /**
  * @brief perform a DME access
@@ -95,6 +98,29 @@ int chip_unipro_attr_write(uint16_t attr,
     return unipro_attr_access(attr, &val, selector, peer, 1);
 }
 
+int chip_unipro_attr_access_batch(struct unipro_attr_req *reqs,
+                                  unsigned int count)
+{
+    return tsb_unipro_attr_access_batch(reqs, count);
+}
+
+/*
+ * Without CONFIG_UNIPRO_HS_GEAR the link is left in the mode it came up in,
+ * but the power mode change still gets built
+ */
+#ifndef CONFIG_UNIPRO_HS_GEAR
+#define CONFIG_UNIPRO_HS_GEAR   0
+#define CONFIG_UNIPRO_HS_SERIES PA_HS_SERIES_A
+#endif
+
+int chip_unipro_change_power_mode(void) {
+    if (CONFIG_UNIPRO_HS_GEAR == 0) {
+        return 0;
+    }
+    return unipro_change_power_mode(CONFIG_UNIPRO_HS_GEAR,
+                                    CONFIG_UNIPRO_HS_SERIES);
+}
+
 /**
  * @brief send data down a CPort
  * @param cportid cport to send down
@@ -130,59 +156,18 @@ int chip_unipro_send(unsigned int cportid, const void *buf, size_t len) {
 }
 
 int chip_unipro_receive(unsigned int cportid, unipro_rx_handler handler) {
-    uint32_t bytes_received;
-    struct cport *cport;
-
-    uint32_t eom_nom_bit;
-    uint32_t eom_err_bit;
-    uint32_t eot_bit;
+    struct unipro_rx_dispatch rx = {cportid, handler};
 
-    uint32_t eom;
-    uint32_t eot;
-
-    cport = cport_handle(cportid);
-    if (!cport) {
-        return -1;
-    }
+    return tsb_unipro_receive_any(&rx, 1) < 0 ? -1 : 0;
+}
 
-    while(1) {
-        eom = tsb_unipro_read(AHM_RX_EOM_INT_BEF_0);
-        eot = tsb_unipro_read(AHM_RX_EOT_INT_BEF_0);
-
-        eom_nom_bit = (0x01 << (cportid << 1));
-        eom_err_bit = (0x10 << (cportid << 1));
-        eot_bit = (1 << cportid);
-
-        if ((eom & eom_err_bit) != 0) {
-            dbgprint("UniPro RX error\n");
-            return -1;
-        }
-        if ((eot & eot_bit) != 0) {
-            dbgprint("data received exceeded max length\n");
-            return -1;
-        }
-        if ((eom & eom_nom_bit) != 0) {
-            bytes_received = tsb_unipro_read(CPB_RX_TRANSFERRED_DATA_SIZE_00 +
-                                             (cportid << 2));
-            tsb_unipro_write(AHM_RX_EOM_INT_BEF_0, eom_nom_bit);
-
-            if (handler != NULL) {
-                if(0 != handler(cportid,
-                                cport->rx_buf,
-                                bytes_received)) {
-                    dbgprint("RX handler returned error\n");
-                    return -1;
-                }
-            }
-            tsb_unipro_restart_rx(cport);
-            return 0;
-        }
-    }
-    return 0;
+int chip_unipro_receive_any(const struct unipro_rx_dispatch *rx,
+                            unsigned int count) {
+    return tsb_unipro_receive_any(rx, count);
 }
 
 void chip_unipro_init(void) {
-    tsb_reset_all_cports();
+    tsb_reset_cports_in_use();
     dbgprint("Unipro enabled!\n");
 }
 
@@ -43,18 +43,135 @@
 #include "debug.h"
 #include "utils.h"
 #include "tsb_scm.h"
+#include "timeline.h"
+
+/* Per-CPort attributes that make up a connection, restored in this order */
+static const uint16_t cport_context_attrs[] = {
+    T_PEERDEVICEID,
+    T_PEERCPORTID,
+    T_TRAFFICCLASS,
+    T_CPORTFLAGS,
+    T_TXTOKENVALUE,
+    T_RXTOKENVALUE,
+    T_CPORTMODE,
+    /*
+     * The E2EFC credit state. Hibernate keeps the peer's side of it, and
+     * the link was idle when it was saved, so the saved values still agree
+     * with the peer's.
+     */
+    T_LOCALBUFFERSPACE,
+    T_PEERBUFFERSPACE,
+    T_CREDITSTOSEND,
+    /* Last, so the connection only opens once it is fully described */
+    T_CONNECTIONSTATE,
+};
+
+#define STANDBY_CONTEXT_VALID   0x55AA3CC3
+
+/*
+ * UniPro state to bring back after standby. Workram is retained, and the
+ * resume path jumps straight back into it without any C runtime startup, so
+ * this survives as it was left.
+ */
+static struct {
+    uint32_t valid;
+    uint32_t e2efc_en[2];
+    struct unipro_attr_req attrs[CPORT_MAX * ARRAY_SIZE(cport_context_attrs)];
+} standby_context;
+
+/**
+ * @brief Snapshot the CPort connections before the link goes down
+ * @return 0 on success, <0 on internal error, >0 on UniPro error
+ */
+static int unipro_save_context(void) {
+    struct unipro_attr_req *req = standby_context.attrs;
+    uint16_t cportid;
+    unsigned int i;
+    int rc;
+
+    standby_context.valid = 0;
+
+    for (cportid = 0; cportid < CPORT_MAX; cportid++) {
+        for (i = 0; i < ARRAY_SIZE(cport_context_attrs); i++) {
+            req->attr = cport_context_attrs[i];
+            req->selector = cportid;
+            req->val = 0;
+            req->peer = ATTR_LOCAL;
+            req->write = 0;
+            req++;
+        }
+    }
+
+    rc = chip_unipro_attr_access_batch(standby_context.attrs,
+                                       ARRAY_SIZE(standby_context.attrs));
+    if (rc) {
+        return rc;
+    }
+
+    standby_context.e2efc_en[0] = tsb_unipro_read(CPB_RX_E2EFC_EN_0);
+    standby_context.e2efc_en[1] = tsb_unipro_read(CPB_RX_E2EFC_EN_1);
+    standby_context.valid = STANDBY_CONTEXT_VALID;
+    return 0;
+}
+
+/**
+ * @brief Re-open the connections saved by unipro_save_context()
+ *
+ * All of the attributes go back in one batch while the CPorts are still
+ * held in reset by chip_enter_hibern8_client(). The CPorts that were
+ * connected are then let out of reset, as tsb_unipro_reset_cports() does,
+ * and have RX re-armed, so no connection setup is needed after resume.
+ * @return 0 on success, <0 on internal error, >0 on UniPro error
+ */
+static int unipro_restore_context(void) {
+    struct unipro_attr_req *req = standby_context.attrs;
+    uint32_t connected = 0;
+    uint32_t cportid;
+    unsigned int i;
+    int rc;
+
+    if (standby_context.valid != STANDBY_CONTEXT_VALID) {
+        return -ENOENT;
+    }
+    standby_context.valid = 0;
+
+    for (i = 0; i < ARRAY_SIZE(standby_context.attrs); i++) {
+        req[i].write = 1;
+    }
+
+    tsb_unipro_write(CPB_RX_E2EFC_EN_0, standby_context.e2efc_en[0]);
+    tsb_unipro_write(CPB_RX_E2EFC_EN_1, standby_context.e2efc_en[1]);
+
+    rc = chip_unipro_attr_access_batch(req, ARRAY_SIZE(standby_context.attrs));
+    if (rc) {
+        return rc;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(standby_context.attrs); i++) {
+        if (req[i].attr == T_CONNECTIONSTATE && req[i].val != 0) {
+            connected |= 1 << req[i].selector;
+        }
+    }
+
+    for (cportid = 0; cportid < CPORT_MAX; cportid++) {
+        if (connected & (1 << cportid)) {
+            tsb_unipro_write(TX_SW_RESET_00 + (cportid << 2), 0);
+            tsb_unipro_write(RX_SW_RESET_00 + (cportid << 2), 0);
+            tsb_unipro_restart_rx(cport_handle(cportid));
+        }
+    }
+
+    return 0;
+}
 
 int chip_enter_hibern8_client(void) {
     uint32_t tx_reset_offset, rx_reset_offset;
     uint32_t cportid;
     int rc;
-    uint32_t tempval;
 
     dbgprint("Wait for hibernate\n");
-    do {
-        rc = chip_unipro_attr_read(TSB_HIBERNATE_ENTER_IND, &tempval, 0,
-                                   ATTR_LOCAL);
-    } while (!rc && tempval == 0);
+    rc = chip_unipro_attr_wait(TSB_HIBERNATE_ENTER_IND, 0, ATTR_LOCAL,
+                               0xFFFFFFFF, 0, UNIPRO_WAIT_NE, NULL);
     if (rc) {
         return rc;
     }
@@ -86,10 +203,8 @@ int chip_exit_hibern8_client(void) {
         return rc;
     }
 
-    do {
-        rc = chip_unipro_attr_read(TSB_HIBERNATE_EXIT_IND, &tempval, 0,
-                                   ATTR_LOCAL);
-    } while (!rc && tempval == 0);
+    rc = chip_unipro_attr_wait(TSB_HIBERNATE_EXIT_IND, 0, ATTR_LOCAL,
+                               0xFFFFFFFF, 0, UNIPRO_WAIT_NE, NULL);
     if (rc) {
         return rc;
     }
@@ -123,10 +238,8 @@ int chip_enter_hibern8_server(void) {
     }
 
     dbgprint("wait for hibernate\n");
-    do {
-        rc = chip_unipro_attr_read(TSB_HIBERNATE_ENTER_IND, &tempval, 0,
-                                   ATTR_LOCAL);
-    } while (!rc && tempval == 0);
+    rc = chip_unipro_attr_wait(TSB_HIBERNATE_ENTER_IND, 0, ATTR_LOCAL,
+                               0xFFFFFFFF, 0, UNIPRO_WAIT_NE, NULL);
     if (rc) {
         return rc;
     }
@@ -134,10 +247,8 @@ int chip_enter_hibern8_server(void) {
     dbgprint("hibernate entered\n");
 
     dbgprint("wait for hibernate exit\n");
-    do {
-        rc = chip_unipro_attr_read(TSB_HIBERNATE_EXIT_IND, &tempval, 0,
-                                   ATTR_LOCAL);
-    } while (!rc && tempval == 0);
+    rc = chip_unipro_attr_wait(TSB_HIBERNATE_EXIT_IND, 0, ATTR_LOCAL,
+                               0xFFFFFFFF, 0, UNIPRO_WAIT_NE, NULL);
     if (rc) {
         return rc;
     }
@@ -153,7 +264,13 @@ int standby_sequence(void) {
 
     putreg32(TEST_WAKEUPSRC, WAKEUPSRC);
 
+    if (unipro_save_context()) {
+        dbgprint("Can't save UniPro context\n");
+    }
+
     chip_enter_hibern8_client();
+    /* The UART loses whatever is still queued once the clocks stop */
+    dbgflush();
 
     while (0 != getreg32((volatile unsigned int*)UNIPRO_CLK_EN));
     tsb_clk_disable(TSB_CLK_UNIPROSYS);
@@ -175,6 +292,14 @@ int standby_sequence(void) {
 }
 
 void resume_sequence_in_workram(void) {
+    /*
+     * Standby stopped the cycle counter, so the resume phase is timed from
+     * a restart at wake, into the timeline the boot left in the
+     * communication area
+     */
+    chip_cycle_counter_init();
+    timeline_begin(BOOT_PHASE_RESUME, 0);
+
     putreg32(SRSTRELEASE_UNIPRO_SYSRESET_N, SOFTRESETRELEASE1);
 
     /* delay 0.1us or more */
@@ -204,5 +329,16 @@ void resume_sequence_in_workram(void) {
     dbginit();
 
     dbgprint("Resumed from standby\n");
-    chip_exit_hibern8_client();
+    if (chip_exit_hibern8_client()) {
+        /* The link is still down, so there are no connections to restore */
+        dbgprint("Can't exit hibernate\n");
+        standby_context.valid = 0;
+        return;
+    }
+
+    if (unipro_restore_context()) {
+        dbgprint("Can't restore UniPro context\n");
+    }
+
+    timeline_end(BOOT_PHASE_RESUME, 0);
 }
@@ -0,0 +1,239 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __CHIPS_HOST_INCLUDE_HOST_H
+#define __CHIPS_HOST_INCLUDE_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tsb_isaa.h"
+#include "capture.h"
+
+/* CPorts the host's UniPro end has */
+#define HOST_CPORT_MAX      4
+
+#define HOST_STRINGIFY_(x) #x
+#define HOST_STRINGIFY(x) HOST_STRINGIFY_(x)
+
+/*
+ * The symbols the ROM code gets from the linker script, which host_main.c
+ * and host_audit.c set. With the ROM's own data in the executable, the whole
+ * of workram below the communication area is free for images.
+ */
+#define HOST_WORKRAM_END (WORKRAM_BASE + WORKRAM_SIZE)
+#define HOST_COMMUNICATION_AREA \
+    (HOST_WORKRAM_END - COMMUNICATION_AREA_LENGTH)
+
+#define HOST_LINKER_SYMBOL(name, value) \
+    __asm__(".globl " #name "\n\t.set " #name ", " HOST_STRINGIFY(value))
+
+/* The SHA-256 and RSA code crypto.c runs, see host_crypto.c */
+typedef enum {
+    HOST_CRYPTO_AUTO,           /* The fastest the CPU has */
+    HOST_CRYPTO_GENERIC,        /* Portable C */
+    HOST_CRYPTO_REFERENCE,      /* MIRACL, as on the chip */
+    HOST_CRYPTO_CHECK,          /* Both the fastest and MIRACL, compared */
+} host_crypto_mode;
+
+/*
+ * The host port runs the boot ROM as a Linux process. Everything a real
+ * bridge would get from its pins, e-Fuses and peers comes from here instead,
+ * filled in by host_main.c from the command line.
+ */
+struct host_config {
+    const char *spi_image;      /* SPI flash image file, NULL for blank */
+    uint32_t spi_size;          /* Flash capacity, a power of 2 */
+    uint32_t spi_clock_khz;     /* SPI clock, 0 for untimed transfers */
+    uint32_t spi_width;         /* Data lines for reads: 1, 2 or 4 */
+    uint32_t spi_overhead_ns;   /* Controller time per command */
+    bool spi_stats;             /* Report the SPI traffic on finish */
+    bool timeline_report;       /* Print the boot timeline on exit */
+    const char *workram_file;   /* File to keep workram in, NULL for none */
+    bool boot_over_unipro;      /* Boot selector SPIBOOT_N pin */
+    uint32_t cpu_mhz;           /* Clock that chip_cycle_count() counts */
+    uint32_t unipro_mid;        /* DME_DDBL1_MANUFACTURERID */
+    uint32_t unipro_pid;        /* DME_DDBL1_PRODUCTID */
+    const char *link_path;      /* File shared with the UniPro peer */
+    uint32_t link_mbps;         /* Link bandwidth, 0 for unlimited */
+    uint32_t link_latency_ns;   /* One-way delay of a message */
+    uint32_t hs_gear;           /* HS gear to move to, 0 to stay slow */
+    uint32_t hs_series;         /* PA_HS_SERIES_A or PA_HS_SERIES_B */
+    uint32_t max_hs_gear;       /* Our end's PA_MAXRXHSGEAR */
+    const char *capture_file;   /* Where to write the _CAPTURE log on exit */
+    const char *replay_file;    /* Capture log to play in place of the AP */
+    uint32_t replay_speed;      /* Divides the recorded delays, 0 for none */
+    uint32_t data_area;         /* Images must end below, 0 for the ROM's */
+    uint32_t efuse_vid;         /* Ara VID e-Fuse */
+    uint32_t efuse_pid;         /* Ara PID e-Fuse */
+    uint32_t efuse_scr;         /* Key revocation bits */
+    bool efuse_ecc_error;       /* Pretend the e-Fuse ECC check failed */
+    host_crypto_mode crypto;    /* SHA-256 and RSA code */
+    uint8_t ims[TSB_ISAA_NUM_IMS_BYTES];
+};
+
+extern struct host_config host_config;
+
+/**
+ * @brief Read the host's monotonic clock
+ * @return Nanoseconds since an arbitrary point
+ */
+uint64_t host_now_ns(void);
+
+/**
+ * @brief Busy-wait, so that the time shows up in cycle counts and profiles
+ * @param deadline host_now_ns() value to wait for
+ */
+void host_wait_until_ns(uint64_t deadline);
+
+/**
+ * @brief Map the SPI flash image, before the boot starts
+ * @return 0 on success, <0 on error
+ */
+int host_spi_open(void);
+
+/**
+ * @brief Unmap the SPI flash, so that host_spi_open() can map another image
+ */
+void host_spi_close(void);
+
+/**
+ * @brief Attach to the UniPro link, before the boot starts
+ *
+ * The link comes up when the process at the other end attaches too.
+ * @return 0 on success, <0 on error
+ */
+int host_unipro_open(void);
+
+/**
+ * @brief Write the _CAPTURE log to the --capture file
+ */
+void host_capture_write(void);
+
+/**
+ * @brief Something the replayed AP sends the boot ROM
+ */
+struct host_replay_rx {
+    capture_type type;          /* CAPTURE_CPORT_RX or CAPTURE_MAILBOX_RX */
+    uint16_t arg;               /* CPort or mailbox value */
+    const void *data;           /* The message */
+    uint16_t length;
+};
+
+/**
+ * @brief Load the --replay capture log, before the boot starts
+ * @return 0 on success, <0 on error
+ */
+int host_replay_open(void);
+
+/**
+ * @brief Get what the replayed AP sends next, if it is due
+ *
+ * Once it has been delivered, call host_replay_delivered(); until then,
+ * this keeps returning the same item.
+ * @param rx Filled in with the item
+ * @return true if an item is due
+ */
+bool host_replay_next(struct host_replay_rx *rx);
+
+/**
+ * @brief Move on from the item host_replay_next() returned
+ */
+void host_replay_delivered(void);
+
+/**
+ * @brief Find out if the replayed AP has nothing left to send
+ */
+bool host_replay_finished(void);
+
+/**
+ * @brief Check something the boot ROM sends against the log
+ * @param type CAPTURE_CPORT_TX or CAPTURE_MAILBOX_TX
+ * @param arg CPort or mailbox value
+ * @param data The message, or NULL
+ * @param length Bytes of message
+ */
+void host_replay_tx(capture_type type, uint16_t arg, const void *data,
+                    uint32_t length);
+
+/**
+ * @brief Erase the flash blocks that hold a range, setting them to 0xFF
+ * @param addr Start of the range, which must be block-aligned
+ * @param length Length of the range, which must be a multiple of the block
+ * @return 0 on success, <0 on error
+ */
+int host_spi_erase(uint32_t addr, uint32_t length);
+
+/**
+ * @brief Program flash a page at a time, which can only clear bits
+ * @param addr Flash address to program
+ * @param src Data to program
+ * @param length Number of bytes
+ * @return 0 on success, <0 on error
+ */
+int host_spi_program(uint32_t addr, const void *src, uint32_t length);
+
+/**
+ * @brief Pick the SHA-256 and RSA code by name, for --crypto
+ * @param name "auto", "generic", "reference" or "check"
+ * @return 0 on success, <0 if there is no such mode
+ */
+int host_crypto_set_mode(const char *name);
+
+/**
+ * @brief SHA-256 of a buffer, with the fastest code for this CPU
+ * @param data The data
+ * @param length Its length
+ * @param digest Where to put the digest
+ */
+void host_sha256(const void *data, uint32_t length, uint8_t digest[32]);
+
+/**
+ * @brief SHA-256 of a number of buffers, several at a time where the CPU can
+ * @param data The buffers
+ * @param length Their lengths
+ * @param digest Where to put the digest of each
+ * @param count Number of buffers
+ */
+void host_sha256_many(const uint8_t *const data[], const uint32_t length[],
+                      uint8_t (*digest)[32], unsigned int count);
+
+/**
+ * @brief Check the host's SHA-256 and RSA code against MIRACL's
+ * @param rounds Number of random messages and moduli, on top of the fixed
+ *        ones
+ * @return 0 if every result is the same, <0 if not
+ */
+int host_crypto_test(unsigned int rounds);
+
+/**
+ * @brief Leave the boot ROM, as a halt or a jump would on the chip
+ * @param status The process exit status
+ */
+void host_exit(int status) __attribute__ ((noreturn));
+
+#endif /* __CHIPS_HOST_INCLUDE_HOST_H */
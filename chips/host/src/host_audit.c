@@ -0,0 +1,451 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Image auditor, built with "make audit" in place of host_main.c
+ *
+ * Runs the boot ROM's own checks, unchanged, over each flash image or TFTF
+ * file named on the command line, as a cold boot would: for a flash image,
+ * locate_ffff_element_on_storage() and load_tftf_image() through the SPI
+ * driver of host_spi.c; for a TFTF file, load_tftf_image() reading it in
+ * order, as gbboot.c reads it from the AP. The ROM code keeps its state in
+ * globals, so the images go one at a time; tools/fwaudit runs one auditor
+ * per CPU. Files with the same contents get the verdict of the first, by
+ * their SHA-256, which host_sha256_many() takes several at a time. For each
+ * image it prints a line:
+ *
+ *   <trusted|untrusted|rejected|error> <br_errno in hex> <file>
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "host.h"
+#include "chipdef.h"
+#include "bootrom.h"
+#include "error.h"
+#include "efuse.h"
+#include "data_loading.h"
+#include "ffff.h"
+#include "tftf.h"
+#include "crypto.h"
+
+HOST_LINKER_SYMBOL(_workram_start, WORKRAM_BASE);
+HOST_LINKER_SYMBOL(_workram_end, HOST_WORKRAM_END);
+HOST_LINKER_SYMBOL(_communication_area, HOST_COMMUNICATION_AREA);
+HOST_LINKER_SYMBOL(_warm_boot_record, HOST_COMMUNICATION_AREA);
+HOST_LINKER_SYMBOL(_bootrom_data_area, HOST_COMMUNICATION_AREA);
+
+extern data_load_ops spi_ops;
+
+uint32_t br_errno;
+
+/* A file named on the command line, and what audit() made of it */
+struct audit_file {
+    const char *path;
+    const uint8_t *data;        /* The file, mapped, NULL if it isn't */
+    uint32_t size;
+    uint8_t digest[HASH_DIGEST_SIZE];
+    const char *verdict;        /* trusted, untrusted, rejected or error */
+    uint32_t error;             /* br_errno */
+    int rc;                     /* 0 trusted, 1 not, 2 unreadable */
+};
+
+struct host_config host_config = {
+    .spi_size = 16 * 1024 * 1024,
+    .spi_width = 1,
+    .cpu_mhz = 48,
+    .unipro_mid = 0x0126,   /* Toshiba */
+    .unipro_pid = 0x1000,
+};
+
+/* As in start.c, the first error sticks */
+void set_last_error(uint32_t err) {
+    if (br_errno == BRE_OK) {
+        br_errno = err;
+    }
+}
+
+/* The TFTF file being audited, mapped */
+static const uint8_t *tftf_file;
+static uint32_t tftf_size;
+static uint32_t tftf_offset;
+
+static int audit_tftf_init(void) {
+    tftf_offset = 0;
+    return 0;
+}
+
+/* Like data_load_greybus_load(), which fails past the end of the file */
+static int audit_tftf_load(void *dest, uint32_t length, bool hash) {
+    if (length > tftf_size - tftf_offset) {
+        return -1;
+    }
+    memcpy(dest, tftf_file + tftf_offset, length);
+    tftf_offset += length;
+    if (hash) {
+        hash_update((unsigned char *)dest, length);
+    }
+    return 0;
+}
+
+static int audit_tftf_finish(bool valid, bool is_secure_image) {
+    return 0;
+}
+
+static data_load_ops tftf_ops = {
+    .init = audit_tftf_init,
+    .read = NULL,
+    .load = audit_tftf_load,
+    .finish = audit_tftf_finish
+};
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options] FILE...\n"
+            "      --data-area ADDR  where the ROM's data starts on the chip,\n"
+            "                        the limit for images (default: the\n"
+            "                        host's, 0x%08x)\n"
+            "      --spi-size BYTES  flash capacity (default 16M)\n"
+            "      --unipro-mid ID   DME_DDBL1_MANUFACTURERID (default 0x126)\n"
+            "      --unipro-pid ID   DME_DDBL1_PRODUCTID (default 0x1000)\n"
+            "      --vid VID         Ara VID e-Fuse (default 0)\n"
+            "      --pid PID         Ara PID e-Fuse (default 0)\n"
+            "      --scr BITS        key revocation e-Fuse bits (default 0)\n"
+            "      --crypto MODE     SHA-256 and RSA code: auto, generic,\n"
+            "                        reference or check (default auto)\n"
+            "Files starting with the TFTF sentinel are audited as boot over\n"
+            "UniPro would load them, the others as flash images.\n"
+            "Exits 0 if every image is trusted, 1 if not, 2 on errors.\n",
+            name, HOST_COMMUNICATION_AREA);
+}
+
+static uint32_t parse_u32(const char *name, const char *arg) {
+    char *end;
+    unsigned long val = strtoul(arg, &end, 0);
+
+    if (*arg == '\0' || *end != '\0' || val > UINT32_MAX) {
+        fprintf(stderr, "bad %s: %s\n", name, arg);
+        exit(2);
+    }
+    return val;
+}
+
+/**
+ * @brief Audit a TFTF file
+ * @param fd The open file
+ * @param size Its size
+ * @param is_secure_image Set if the image is signed and verified
+ * @return 0 if the boot ROM would jump to it, -1 if not
+ */
+static int audit_tftf(int fd, uint32_t size, uint32_t *is_secure_image) {
+    void *p = NULL;
+    int rc;
+
+    if (size > 0) {
+        p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            return -1;
+        }
+    }
+    tftf_file = p;
+    tftf_size = size;
+
+    tftf_ops.init();
+    rc = load_tftf_image(&tftf_ops, is_secure_image);
+    tftf_ops.finish(rc == 0, *is_secure_image);
+
+    if (p) {
+        munmap(p, size);
+    }
+    return rc;
+}
+
+/**
+ * @brief Audit a flash image, as bootrom_main() boots from SPI
+ * @param path The image file
+ * @param is_secure_image Set if the image is signed and verified
+ * @return 0 if the boot ROM would jump to it, -1 if not
+ */
+static int audit_flash(const char *path, uint32_t *is_secure_image) {
+    int rc = -1;
+
+    host_config.spi_image = path;
+    if (host_spi_open() == 0) {
+        spi_ops.init();
+        rc = locate_ffff_element_on_storage(&spi_ops, BOOT_STAGE, NULL);
+        if (rc == 0) {
+            rc = load_tftf_image(&spi_ops, is_secure_image);
+        }
+        spi_ops.finish(rc == 0, *is_secure_image);
+    }
+    host_spi_close();
+    return rc;
+}
+
+/**
+ * @brief Audit one file, filling in its verdict, error and rc
+ */
+static void audit(struct audit_file *file) {
+    const char *path = file->path;
+    uint32_t is_secure_image = 0;
+    char sentinel[TFTF_SENTINEL_SIZE];
+    struct stat st;
+    int fd;
+    int rc;
+
+    /* A cold boot, as far as images go */
+    memset((void *)WORKRAM_BASE, 0, HOST_COMMUNICATION_AREA - WORKRAM_BASE);
+    init_last_error();
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0 || st.st_size > UINT32_MAX) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        file->verdict = "error";
+        file->error = BRE_OK;
+        file->rc = 2;
+        return;
+    }
+
+    if (pread(fd, sentinel, sizeof(sentinel), 0) == sizeof(sentinel) &&
+        memcmp(sentinel, TFTF_SENTINEL_VALUE, sizeof(sentinel)) == 0) {
+        rc = audit_tftf(fd, st.st_size, &is_secure_image);
+    } else {
+        rc = audit_flash(path, &is_secure_image);
+    }
+    close(fd);
+
+    file->error = get_last_error();
+    if (rc != 0) {
+        file->verdict = "rejected";
+        file->rc = 1;
+    } else {
+        file->verdict = is_secure_image ? "trusted" : "untrusted";
+        file->rc = is_secure_image ? 0 : 1;
+    }
+}
+
+/**
+ * @brief Map the files and hash them, for the_same()
+ */
+static void hash_files(struct audit_file *files, unsigned int count) {
+    const uint8_t **data;
+    uint32_t *length;
+    uint8_t (*digest)[HASH_DIGEST_SIZE];
+    unsigned int mapped = 0;
+    unsigned int i;
+    struct stat st;
+    void *p;
+    int fd;
+
+    data = malloc(count * sizeof(*data));
+    length = malloc(count * sizeof(*length));
+    digest = malloc(count * sizeof(*digest));
+    if (!data || !length || !digest) {
+        goto out;
+    }
+
+    for (i = 0; i < count; i++) {
+        fd = open(files[i].path, O_RDONLY);
+        if (fd < 0) {
+            continue;
+        }
+        if (fstat(fd, &st) == 0 && st.st_size > 0 &&
+            st.st_size <= UINT32_MAX) {
+            p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                files[i].data = p;
+                files[i].size = st.st_size;
+                data[mapped] = p;
+                length[mapped] = st.st_size;
+                mapped++;
+            }
+        }
+        close(fd);
+    }
+
+    host_sha256_many(data, length, digest, mapped);
+    for (i = 0, mapped = 0; i < count; i++) {
+        if (files[i].data) {
+            memcpy(files[i].digest, digest[mapped++], HASH_DIGEST_SIZE);
+        }
+    }
+
+out:
+    free(data);
+    free(length);
+    free(digest);
+}
+
+/**
+ * @brief Find an earlier file with the same contents
+ * @return The file, or NULL if there is none
+ */
+static const struct audit_file *the_same(const struct audit_file *files,
+                                         const struct audit_file *file) {
+    const struct audit_file *f;
+
+    if (!file->data) {
+        return NULL;
+    }
+    for (f = files; f < file; f++) {
+        if (f->data && f->size == file->size &&
+            memcmp(f->digest, file->digest, HASH_DIGEST_SIZE) == 0) {
+            return f;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    enum {
+        OPT_DATA_AREA = 256,
+        OPT_SPI_SIZE,
+        OPT_UNIPRO_MID,
+        OPT_UNIPRO_PID,
+        OPT_VID,
+        OPT_PID,
+        OPT_SCR,
+        OPT_CRYPTO,
+    };
+    static const struct option options[] = {
+        { "data-area", required_argument, NULL, OPT_DATA_AREA },
+        { "spi-size", required_argument, NULL, OPT_SPI_SIZE },
+        { "unipro-mid", required_argument, NULL, OPT_UNIPRO_MID },
+        { "unipro-pid", required_argument, NULL, OPT_UNIPRO_PID },
+        { "vid", required_argument, NULL, OPT_VID },
+        { "pid", required_argument, NULL, OPT_PID },
+        { "scr", required_argument, NULL, OPT_SCR },
+        { "crypto", required_argument, NULL, OPT_CRYPTO },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    struct audit_file *files, *file;
+    const struct audit_file *same;
+    unsigned int count, i;
+    int status = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+        case OPT_DATA_AREA:
+            host_config.data_area = parse_u32("data area", optarg);
+            break;
+        case OPT_SPI_SIZE:
+            host_config.spi_size = parse_u32("SPI flash size", optarg);
+            break;
+        case OPT_UNIPRO_MID:
+            host_config.unipro_mid = parse_u32("UniPro MID", optarg);
+            break;
+        case OPT_UNIPRO_PID:
+            host_config.unipro_pid = parse_u32("UniPro PID", optarg);
+            break;
+        case OPT_VID:
+            host_config.efuse_vid = parse_u32("VID", optarg);
+            break;
+        case OPT_PID:
+            host_config.efuse_pid = parse_u32("PID", optarg);
+            break;
+        case OPT_SCR:
+            host_config.efuse_scr = parse_u32("SCR", optarg);
+            break;
+        case OPT_CRYPTO:
+            if (host_crypto_set_mode(optarg)) {
+                fprintf(stderr, "bad crypto mode: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind == argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (mmap((void *)WORKRAM_BASE, WORKRAM_SIZE, PROT_READ | PROT_WRITE,
+             MAP_FIXED_NOREPLACE | MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) !=
+        (void *)WORKRAM_BASE) {
+        perror("mapping workram");
+        return 2;
+    }
+    if (host_unipro_open()) {
+        return 2;
+    }
+
+    /* The set-up bootrom_main() does before it looks for an image */
+    init_last_error();
+    chip_init();
+    crypto_init();
+    chip_unipro_init();
+    if (efuse_init() != 0) {
+        fprintf(stderr, "bad e-Fuses: 0x%06x\n", get_last_error());
+        return 2;
+    }
+
+    count = argc - optind;
+    files = calloc(count, sizeof(*files));
+    if (!files) {
+        perror("audit");
+        return 2;
+    }
+    for (i = 0; i < count; i++) {
+        files[i].path = argv[optind + i];
+    }
+    hash_files(files, count);
+
+    for (i = 0; i < count; i++) {
+        file = &files[i];
+        same = the_same(files, file);
+        if (same) {
+            file->verdict = same->verdict;
+            file->error = same->error;
+            file->rc = same->rc;
+        } else {
+            audit(file);
+        }
+        printf("%s 0x%06x %s\n", file->verdict, file->error, file->path);
+        if (file->rc > status) {
+            status = file->rc;
+        }
+    }
+    return status;
+}
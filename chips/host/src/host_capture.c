@@ -0,0 +1,271 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Greybus capture logs on the host: writing the _CAPTURE log to a file, and
+ * replaying one in place of the AP.
+ *
+ * The replay plays the other side of a session the boot ROM recorded. The
+ * messages and mailbox values the boot ROM received go to it again, in the
+ * order of the log, while what it sends is checked against what it sent
+ * then. Each received item waits for everything the boot ROM sent before it
+ * in the log, as the AP would have, and then for the time that passed
+ * after that in the recorded session, divided by --replay-speed (0 for no
+ * wait). A loader that is faster or slower than the one recorded thus sees
+ * the same AP, responding just as quickly.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "host.h"
+#include "capture.h"
+#include "tsb_unipro.h"
+
+struct replay_item {
+    capture_record record;
+    const uint8_t *data;
+    int prev_rx;            /* Index of the RX item before, -1 for none */
+    int prev_tx;            /* Index of the TX item before, -1 for none */
+    uint64_t done_ns;       /* When it was delivered or sent */
+};
+
+static struct replay_item *items;
+static unsigned int item_count;
+static unsigned int next_rx;
+static unsigned int next_tx;
+static unsigned int clock_mhz;
+static unsigned int tx_mismatches;
+static unsigned int tx_extra;
+
+#ifdef _CAPTURE
+void host_capture_write(void) {
+    capture_log_header *header = capture_log();
+    FILE *f;
+
+    /* The cycle counter runs at --clock here, not at the ES3 rate */
+    header->clock_mhz = host_config.cpu_mhz;
+
+    f = fopen(host_config.capture_file, "wb");
+    if (!f || fwrite(header, sizeof(*header) + header->length, 1, f) != 1) {
+        perror(host_config.capture_file);
+    }
+    if (f) {
+        fclose(f);
+    }
+    if (header->dropped) {
+        fprintf(stderr, "capture: %u records didn't fit in the log\n",
+                header->dropped);
+    }
+}
+#endif
+
+static bool is_rx(const struct replay_item *item) {
+    return item->record.type == CAPTURE_CPORT_RX ||
+           item->record.type == CAPTURE_MAILBOX_RX;
+}
+
+static unsigned int skip_to(unsigned int i, bool rx) {
+    while (i < item_count && is_rx(&items[i]) != rx) {
+        i++;
+    }
+    return i;
+}
+
+static void replay_report(void) {
+    unsigned int rx_total = 0;
+    unsigned int rx_done = 0;
+    unsigned int tx_done = 0;
+    unsigned int i;
+
+    for (i = 0; i < item_count; i++) {
+        if (is_rx(&items[i])) {
+            rx_total++;
+            rx_done += i < next_rx;
+        } else {
+            tx_done += i < next_tx;
+        }
+    }
+    fprintf(stderr, "replay: %u of %u received items delivered, "
+            "%u of %u sent items seen, %u differing, %u extra\n",
+            rx_done, rx_total, tx_done, item_count - rx_total,
+            tx_mismatches, tx_extra);
+}
+
+int host_replay_open(void) {
+    capture_log_header header;
+    capture_record record;
+    uint8_t *data;
+    uint32_t pos;
+    int prev_rx = -1;
+    int prev_tx = -1;
+    FILE *f;
+
+    f = fopen(host_config.replay_file, "rb");
+    if (!f) {
+        perror(host_config.replay_file);
+        return -1;
+    }
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, CAPTURE_LOG_MAGIC, sizeof(header.magic)) ||
+        header.version != CAPTURE_LOG_VERSION || header.clock_mhz == 0) {
+        fprintf(stderr, "%s: not a capture log\n", host_config.replay_file);
+        fclose(f);
+        return -1;
+    }
+    data = malloc(header.length + 1);
+    if (!data || fread(data, 1, header.length, f) != header.length) {
+        fprintf(stderr, "%s: truncated\n", host_config.replay_file);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    if (header.dropped) {
+        fprintf(stderr, "%s: the last %u records didn't fit, the replay "
+                "stops short of them\n", host_config.replay_file,
+                header.dropped);
+    }
+
+    /* Index the records, which are packed and not aligned */
+    for (pos = 0; pos + sizeof(record) <= header.length;
+         pos += sizeof(record) + record.length) {
+        memcpy(&record, &data[pos], sizeof(record));
+        if (record.type >= NUMBER_OF_CAPTURE_TYPES ||
+            pos + sizeof(record) + record.length > header.length ||
+            ((record.type == CAPTURE_CPORT_RX) &&
+             (record.arg >= HOST_CPORT_MAX ||
+              record.length > CPORT_RX_BUF_HALF_SIZE))) {
+            break;
+        }
+        items = realloc(items, (item_count + 1) * sizeof(*items));
+        if (!items) {
+            perror("replay");
+            return -1;
+        }
+        items[item_count].record = record;
+        items[item_count].data = &data[pos + sizeof(record)];
+        items[item_count].prev_rx = prev_rx;
+        items[item_count].prev_tx = prev_tx;
+        items[item_count].done_ns = 0;
+        if (is_rx(&items[item_count])) {
+            prev_rx = item_count;
+        } else {
+            prev_tx = item_count;
+        }
+        item_count++;
+    }
+    if (pos != header.length) {
+        fprintf(stderr, "%s: bad record at byte %u\n",
+                host_config.replay_file, (unsigned int)(sizeof(header) + pos));
+        return -1;
+    }
+
+    clock_mhz = header.clock_mhz;
+    next_rx = skip_to(0, true);
+    next_tx = skip_to(0, false);
+    atexit(replay_report);
+    return 0;
+}
+
+/**
+ * @brief When an item is due, going by the item before it
+ */
+static uint64_t due_after(const struct replay_item *item, int prev) {
+    uint32_t cycles;
+
+    if (prev < 0 || host_config.replay_speed == 0) {
+        return prev < 0 ? 0 : items[prev].done_ns;
+    }
+    cycles = item->record.cycles - items[prev].record.cycles;
+    return items[prev].done_ns +
+           (uint64_t)cycles * 1000 / clock_mhz / host_config.replay_speed;
+}
+
+bool host_replay_next(struct host_replay_rx *rx) {
+    struct replay_item *item;
+    uint64_t due;
+    uint64_t due_tx;
+
+    if (next_rx >= item_count) {
+        return false;
+    }
+    item = &items[next_rx];
+
+    /* The AP sent it after seeing everything the boot ROM sent before it */
+    if (item->prev_tx >= (int)next_tx) {
+        return false;
+    }
+    due = due_after(item, item->prev_rx);
+    due_tx = due_after(item, item->prev_tx);
+    if (due_tx > due) {
+        due = due_tx;
+    }
+    if (host_now_ns() < due) {
+        return false;
+    }
+
+    rx->type = item->record.type;
+    rx->arg = item->record.arg;
+    rx->data = item->data;
+    rx->length = item->record.length;
+    return true;
+}
+
+void host_replay_delivered(void) {
+    items[next_rx].done_ns = host_now_ns();
+    next_rx = skip_to(next_rx + 1, true);
+}
+
+bool host_replay_finished(void) {
+    return next_rx >= item_count;
+}
+
+void host_replay_tx(capture_type type, uint16_t arg, const void *data,
+                    uint32_t length) {
+    struct replay_item *item;
+
+    if (next_tx >= item_count) {
+        if (tx_extra++ == 0) {
+            fprintf(stderr, "replay: sent more than the log has\n");
+        }
+        return;
+    }
+    item = &items[next_tx];
+
+    if (item->record.type != type || item->record.arg != arg ||
+        item->record.length != length ||
+        (length != 0 && memcmp(item->data, data, length) != 0)) {
+        if (tx_mismatches++ == 0) {
+            fprintf(stderr, "replay: sent item %u differs from the log\n",
+                    next_tx);
+        }
+    }
+    item->done_ns = host_now_ns();
+    next_tx = skip_to(next_tx + 1, false);
+}
@@ -0,0 +1,166 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "host.h"
+#include "chipapi.h"
+#include "bootrom.h"
+#include "timeline.h"
+#include "debug.h"
+
+extern char _workram_start, _bootrom_data_area;
+
+void chip_init(void) {
+}
+
+#ifdef CONFIG_BOOT_TIMELINE
+/**
+ * @brief Print the boot timeline from the communication area to stderr
+ *
+ * One "timeline" line per item, for tools/bootbench to read: the clock,
+ * the boot source, the counters by index, then the events as phase, begin
+ * or end, argument and cycle count.
+ */
+static void report_timeline(void) {
+    boot_timeline *timeline =
+        &((communication_area *)&_communication_area)->timeline;
+    timeline_event *event;
+    uint32_t count;
+    uint32_t i;
+
+    fprintf(stderr, "timeline clock %u\n", host_config.cpu_mhz);
+    fprintf(stderr, "timeline source %u\n", timeline->boot_source);
+    for (i = 0; i < NUMBER_OF_BOOT_COUNTERS; i++) {
+        fprintf(stderr, "timeline counter %u %u\n", i, timeline->counters[i]);
+    }
+    count = timeline->count;
+    if (count > TIMELINE_MAX_EVENTS) {
+        fprintf(stderr, "timeline lost %u\n", count - TIMELINE_MAX_EVENTS);
+        count = TIMELINE_MAX_EVENTS;
+    }
+    for (i = 0; i < count; i++) {
+        event = &timeline->events[i];
+        fprintf(stderr, "timeline event %u %s %u %u\n", event->phase,
+                event->type == TIMELINE_EVENT_BEGIN ? "begin" : "end",
+                event->arg, event->cycles);
+    }
+}
+#endif /* CONFIG_BOOT_TIMELINE */
+
+void host_exit(int status) {
+    dbgflush();
+#ifdef CONFIG_BOOT_TIMELINE
+    if (host_config.timeline_report) {
+        report_timeline();
+    }
+#endif
+#ifdef _CAPTURE
+    if (host_config.capture_file) {
+        host_capture_write();
+    }
+#endif
+    exit(status);
+}
+
+/*
+ * As tsb_chipapi.c has it for the ES3 boot ROM. On the chip the ROM's data
+ * sits lower in workram than here; host_config.data_area moves the limit
+ * there, for the auditor.
+ */
+int chip_validate_data_load_location(void *base, uint32_t length) {
+    uint32_t data_area = host_config.data_area ?
+                         host_config.data_area :
+                         (uintptr_t)&_bootrom_data_area;
+
+    if ((uintptr_t)base < (uintptr_t)&_workram_start) {
+        return -1;
+    }
+    if ((uintptr_t)base + length >= data_area) {
+        return -1;
+    }
+    return 0;
+}
+
+void chip_reset_before_jump(void) {
+}
+
+/**
+ * @brief Finish the run where the chip would start the loaded image
+ *
+ * The image is built for the bridge, so there is nothing to run: reaching
+ * this point is the successful end of the boot.
+ */
+void chip_jump_to_image(uint32_t start_address) {
+    dbgprintx32("Jump to image at ", start_address, "\n");
+    host_exit(0);
+}
+
+int chip_is_key_revoked(int index) {
+    return (host_config.efuse_scr & (1 << index)) != 0;
+}
+
+int chip_enter_standby(void) {
+    dbgprint("Standby is not simulated\n");
+    return -1;
+}
+
+/*
+ * The cycle counter is the monotonic clock scaled to the configured CPU
+ * clock, so that cycle counts in the timeline and the metrics read as they
+ * would on the chip, if it ran as fast as the host.
+ */
+static uint64_t cycle_base_ns;
+
+uint64_t host_now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void chip_cycle_counter_init(void) {
+    cycle_base_ns = host_now_ns();
+}
+
+uint32_t chip_cycle_count(void) {
+    return (host_now_ns() - cycle_base_ns) * host_config.cpu_mhz / 1000;
+}
+
+/**
+ * @brief Busy-wait, 200ns per unit as on the chip (see CHIP_NS_TO_DELAY)
+ */
+void chip_delay(uint32_t delay) {
+    host_wait_until_ns(host_now_ns() + (uint64_t)delay * 200);
+}
+
+void host_wait_until_ns(uint64_t deadline) {
+    while (host_now_ns() < deadline);
+}
@@ -0,0 +1,1113 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * SHA-256 and RSA-2048 for the host build, in place of MIRACL's
+ * (CONFIG_CHIP_CRYPTO)
+ *
+ * MIRACL is written for the Cortex-M3: SHA-256 takes a byte per call and
+ * RSA works in 32-bit limbs with a long division per multiply. Here the
+ * SHA-256 block function is picked at run time from what the CPU has:
+ * the x86 SHA extensions, the ARMv8 SHA2 instructions, or portable C. The
+ * RSA check raises the signature to 65537 in 64-bit limbs, by Montgomery
+ * multiplication. On x86 CPUs without the SHA extensions,
+ * host_sha256_many() hashes eight messages at a time in the lanes of AVX2
+ * registers.
+ *
+ * --crypto picks the code crypto.c runs: "auto", "generic" (the portable C
+ * only), "reference" (MIRACL's, as on the chip) or "check" (both, stopping
+ * if they ever disagree). --crypto-test runs every backend the CPU has
+ * against MIRACL.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "host.h"
+#include "chipapi.h"
+#include "crypto.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define HOST_CRYPTO_X86
+#endif
+
+#ifdef __aarch64__
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_neon.h>
+#define HOST_CRYPTO_ARMV8
+#endif
+
+/*
+ * A private copy of the MIRACL code, for its round constants and for the
+ * static kernels --crypto-test checks against, as in bench.c
+ */
+#define shs256_init     host_shs256_init
+#define shs256_process  host_shs256_process
+#define shs256_hash     host_shs256_hash
+#define rsa_verify      host_rsa_verify
+#define output          host_output
+#define hashit          host_hashit
+#define pkcs_v15        host_pkcs_v15
+#define SHA256ID        host_SHA256ID
+#include "../../../common/vendors/MIRACL/bootrom.c"
+
+/* What crypto.c publishes, and runs itself without CONFIG_CHIP_CRYPTO */
+extern void (*sha256_init_func)(sha256 *sh);
+extern void (*sha256_process_func)(sha256 *sh, int byte);
+extern void (*sha256_hash_func)(sha256 *sh, char hash[32]);
+extern int (*rsa2048_verify_func)(char digest[], char signature[],
+                                  char public_key[]);
+
+#define SHA256_BLOCK_SIZE       64
+#define SHA256_LANES            8
+
+typedef void (*sha256_blocks_fn)(uint32_t state[8], const uint8_t *data,
+                                 size_t blocks);
+
+struct sha256_ctx {
+    uint32_t state[8];
+    uint8_t buf[SHA256_BLOCK_SIZE];
+    uint64_t length;
+    sha256_blocks_fn blocks;
+};
+
+static const uint32_t sha256_initial[8] = { H0, H1, H2, H3, H4, H5, H6, H7 };
+
+static inline uint32_t load_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t x) {
+    p[0] = x >> 24;
+    p[1] = x >> 16;
+    p[2] = x >> 8;
+    p[3] = x;
+}
+
+static inline uint32_t ror32(uint32_t x, unsigned int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static void sha256_blocks_generic(uint32_t state[8], const uint8_t *data,
+                                  size_t blocks) {
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h, t1, t2;
+    int j;
+
+    for (; blocks > 0; blocks--, data += SHA256_BLOCK_SIZE) {
+        for (j = 0; j < 16; j++) {
+            w[j] = load_be32(data + 4 * j);
+        }
+        for (j = 16; j < 64; j++) {
+            w[j] = (ror32(w[j - 2], 17) ^ ror32(w[j - 2], 19) ^
+                    (w[j - 2] >> 10)) + w[j - 7] +
+                   (ror32(w[j - 15], 7) ^ ror32(w[j - 15], 18) ^
+                    (w[j - 15] >> 3)) + w[j - 16];
+        }
+
+        a = state[0]; b = state[1]; c = state[2]; d = state[3];
+        e = state[4]; f = state[5]; g = state[6]; h = state[7];
+        for (j = 0; j < 64; j++) {
+            t1 = h + (ror32(e, 6) ^ ror32(e, 11) ^ ror32(e, 25)) +
+                 ((e & f) ^ (~e & g)) + K[j] + w[j];
+            t2 = (ror32(a, 2) ^ ror32(a, 13) ^ ror32(a, 22)) +
+                 ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+static bool cpu_has_generic(void) {
+    return true;
+}
+
+#ifdef HOST_CRYPTO_X86
+static bool cpu_has_sha_ni(void) {
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ebx & bit_SHA) && __builtin_cpu_supports("sse4.1") &&
+           __builtin_cpu_supports("ssse3");
+}
+
+static bool cpu_has_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+/*
+ * The SHA extensions keep the state as ABEF and CDGH, and do two rounds
+ * per sha256rnds2, four message words per group of rounds
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_blocks_sha_ni(uint32_t state[8], const uint8_t *data,
+                                 size_t blocks) {
+    const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                         0x0405060700010203ULL);
+    __m128i state0, state1, abef, cdgh, msg, tmp;
+    __m128i w[4];
+    int g;
+
+    tmp = _mm_loadu_si128((const __m128i *)&state[0]);
+    state1 = _mm_loadu_si128((const __m128i *)&state[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xb1);                 /* CDAB */
+    state1 = _mm_shuffle_epi32(state1, 0x1b);           /* EFGH */
+    state0 = _mm_alignr_epi8(tmp, state1, 8);           /* ABEF */
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);        /* CDGH */
+
+    for (; blocks > 0; blocks--, data += SHA256_BLOCK_SIZE) {
+        abef = state0;
+        cdgh = state1;
+
+        /* Unrolled, the message words stay in registers */
+#pragma GCC unroll 16
+        for (g = 0; g < 16; g++) {
+            if (g < 4) {
+                msg = _mm_loadu_si128((const __m128i *)(data + 16 * g));
+                w[g] = _mm_shuffle_epi8(msg, bswap);
+            } else {
+                /* W[4g..4g+3] from the four groups before */
+                msg = _mm_sha256msg1_epu32(w[g & 3], w[(g + 1) & 3]);
+                msg = _mm_add_epi32(msg, _mm_alignr_epi8(w[(g + 3) & 3],
+                                                         w[(g + 2) & 3], 4));
+                w[g & 3] = _mm_sha256msg2_epu32(msg, w[(g + 3) & 3]);
+            }
+            msg = _mm_add_epi32(w[g & 3],
+                                _mm_loadu_si128((const __m128i *)&K[4 * g]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg = _mm_shuffle_epi32(msg, 0x0e);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);              /* FEBA */
+    state1 = _mm_shuffle_epi32(state1, 0xb1);           /* DCHG */
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0);        /* DCBA */
+    state1 = _mm_alignr_epi8(state1, tmp, 8);           /* HGFE */
+    _mm_storeu_si128((__m128i *)&state[0], state0);
+    _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+#define AVX2_ROR(x, n) \
+    _mm256_or_si256(_mm256_srli_epi32((x), (n)), \
+                    _mm256_slli_epi32((x), 32 - (n)))
+
+/**
+ * @brief One block of each of eight messages, a message per 32-bit lane
+ * @param state The eight states, word by word: state[word][lane]
+ * @param block The next block of each message
+ */
+__attribute__((target("avx2")))
+static void sha256_x8_avx2(uint32_t state[8][SHA256_LANES],
+                           const uint8_t *const block[SHA256_LANES]) {
+    const __m256i bswap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                            0x0405060700010203ULL,
+                                            0x0c0d0e0f08090a0bULL,
+                                            0x0405060700010203ULL);
+    __m256i w[16], s[8], r[8], t[8], u[8];
+    __m256i a, b, c, d, e, f, g, h, t1, t2, s0, s1;
+    int half, i, j;
+
+    /* Transpose each half block of the eight messages into words */
+    for (half = 0; half < 2; half++) {
+        for (i = 0; i < SHA256_LANES; i++) {
+            r[i] = _mm256_loadu_si256((const __m256i *)(block[i] + 32 * half));
+        }
+        for (i = 0; i < SHA256_LANES; i += 2) {
+            t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+            t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+        }
+        for (i = 0; i < SHA256_LANES; i += 4) {
+            u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+            u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+            u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+            u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+        }
+        for (i = 0; i < 4; i++) {
+            w[8 * half + i] = _mm256_shuffle_epi8(
+                _mm256_permute2x128_si256(u[i], u[i + 4], 0x20), bswap);
+            w[8 * half + i + 4] = _mm256_shuffle_epi8(
+                _mm256_permute2x128_si256(u[i], u[i + 4], 0x31), bswap);
+        }
+    }
+
+    for (i = 0; i < 8; i++) {
+        s[i] = _mm256_loadu_si256((const __m256i *)state[i]);
+    }
+    a = s[0]; b = s[1]; c = s[2]; d = s[3];
+    e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+    for (j = 0; j < 64; j++) {
+        if (j >= 16) {
+            s0 = w[(j - 15) & 15];
+            s0 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROR(s0, 7),
+                                                   AVX2_ROR(s0, 18)),
+                                  _mm256_srli_epi32(s0, 3));
+            s1 = w[(j - 2) & 15];
+            s1 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROR(s1, 17),
+                                                   AVX2_ROR(s1, 19)),
+                                  _mm256_srli_epi32(s1, 10));
+            w[j & 15] = _mm256_add_epi32(
+                _mm256_add_epi32(w[j & 15], s0),
+                _mm256_add_epi32(w[(j - 7) & 15], s1));
+        }
+        t1 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROR(e, 6),
+                                               AVX2_ROR(e, 11)),
+                              AVX2_ROR(e, 25));
+        t1 = _mm256_add_epi32(_mm256_add_epi32(h, t1),
+                              _mm256_xor_si256(_mm256_and_si256(e, f),
+                                               _mm256_andnot_si256(e, g)));
+        t1 = _mm256_add_epi32(t1, _mm256_add_epi32(
+                                      _mm256_set1_epi32(K[j]), w[j & 15]));
+        t2 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROR(a, 2),
+                                               AVX2_ROR(a, 13)),
+                              AVX2_ROR(a, 22));
+        t2 = _mm256_add_epi32(t2, _mm256_or_si256(
+                                      _mm256_and_si256(a, b),
+                                      _mm256_and_si256(c, _mm256_or_si256(a, b))));
+        h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+        d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+    }
+
+    s[0] = _mm256_add_epi32(s[0], a); s[1] = _mm256_add_epi32(s[1], b);
+    s[2] = _mm256_add_epi32(s[2], c); s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e); s[5] = _mm256_add_epi32(s[5], f);
+    s[6] = _mm256_add_epi32(s[6], g); s[7] = _mm256_add_epi32(s[7], h);
+    for (i = 0; i < 8; i++) {
+        _mm256_storeu_si256((__m256i *)state[i], s[i]);
+    }
+}
+#endif /* HOST_CRYPTO_X86 */
+
+#ifdef HOST_CRYPTO_ARMV8
+static bool cpu_has_sha2(void) {
+    return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+
+__attribute__((target("arch=armv8-a+crypto")))
+static void sha256_blocks_armv8(uint32_t state[8], const uint8_t *data,
+                                size_t blocks) {
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+    uint32x4_t abcd, efgh, msg, tmp;
+    uint32x4_t w[4];
+    int g;
+
+    for (; blocks > 0; blocks--, data += SHA256_BLOCK_SIZE) {
+        abcd = state0;
+        efgh = state1;
+
+        for (g = 0; g < 4; g++) {
+            w[g] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * g)));
+        }
+#pragma GCC unroll 16
+        for (g = 0; g < 16; g++) {
+            msg = vaddq_u32(w[g & 3], vld1q_u32(&K[4 * g]));
+            if (g < 12) {
+                /* W[4g+16..4g+19], into the slot just used */
+                w[g & 3] = vsha256su1q_u32(vsha256su0q_u32(w[g & 3],
+                                                           w[(g + 1) & 3]),
+                                           w[(g + 2) & 3], w[(g + 3) & 3]);
+            }
+            tmp = state0;
+            state0 = vsha256hq_u32(state0, state1, msg);
+            state1 = vsha256h2q_u32(state1, tmp, msg);
+        }
+
+        state0 = vaddq_u32(state0, abcd);
+        state1 = vaddq_u32(state1, efgh);
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+#endif /* HOST_CRYPTO_ARMV8 */
+
+struct sha256_backend {
+    const char *name;
+    bool (*supported)(void);
+    sha256_blocks_fn blocks;
+};
+
+/* Fastest first */
+static const struct sha256_backend sha256_backends[] = {
+#ifdef HOST_CRYPTO_X86
+    { "sha-ni", cpu_has_sha_ni, sha256_blocks_sha_ni },
+#endif
+#ifdef HOST_CRYPTO_ARMV8
+    { "armv8", cpu_has_sha2, sha256_blocks_armv8 },
+#endif
+    { "generic", cpu_has_generic, sha256_blocks_generic },
+};
+
+#define SHA256_BACKENDS (sizeof(sha256_backends) / sizeof(sha256_backends[0]))
+
+/* The generic code until chip_crypto_init() has looked at the CPU */
+static const struct sha256_backend *sha256_backend =
+    &sha256_backends[SHA256_BACKENDS - 1];
+static bool use_avx2_many;
+
+static void sha256_start(struct sha256_ctx *ctx, sha256_blocks_fn blocks) {
+    memcpy(ctx->state, sha256_initial, sizeof(ctx->state));
+    ctx->length = 0;
+    ctx->blocks = blocks;
+}
+
+static void sha256_update(struct sha256_ctx *ctx, const uint8_t *data,
+                          size_t length) {
+    size_t used = ctx->length % SHA256_BLOCK_SIZE;
+    size_t n;
+
+    ctx->length += length;
+    if (used) {
+        n = SHA256_BLOCK_SIZE - used;
+        if (n > length) {
+            n = length;
+        }
+        memcpy(ctx->buf + used, data, n);
+        data += n;
+        length -= n;
+        if (used + n < SHA256_BLOCK_SIZE) {
+            return;
+        }
+        ctx->blocks(ctx->state, ctx->buf, 1);
+    }
+    if (length >= SHA256_BLOCK_SIZE) {
+        n = length / SHA256_BLOCK_SIZE;
+        ctx->blocks(ctx->state, data, n);
+        data += n * SHA256_BLOCK_SIZE;
+        length -= n * SHA256_BLOCK_SIZE;
+    }
+    memcpy(ctx->buf, data, length);
+}
+
+/**
+ * @brief Lay out the padding of a message, after its last partial block
+ * @param tail Filled with the last one or two blocks of the message
+ * @param partial The bytes of the message after its last whole block
+ * @param length The length of the whole message
+ * @return The number of blocks in tail
+ */
+static unsigned int sha256_tail(uint8_t tail[2 * SHA256_BLOCK_SIZE],
+                                const uint8_t *partial, uint64_t length) {
+    size_t used = length % SHA256_BLOCK_SIZE;
+    unsigned int blocks = used < SHA256_BLOCK_SIZE - 8 ? 1 : 2;
+    uint64_t bits = length * 8;
+    int i;
+
+    memset(tail, 0, 2 * SHA256_BLOCK_SIZE);
+    memcpy(tail, partial, used);
+    tail[used] = 0x80;
+    for (i = 0; i < 8; i++) {
+        tail[blocks * SHA256_BLOCK_SIZE - 1 - i] = bits >> (8 * i);
+    }
+    return blocks;
+}
+
+static void sha256_final(struct sha256_ctx *ctx, uint8_t digest[32]) {
+    uint8_t tail[2 * SHA256_BLOCK_SIZE];
+    unsigned int blocks;
+    int i;
+
+    blocks = sha256_tail(tail, ctx->buf, ctx->length);
+    ctx->blocks(ctx->state, tail, blocks);
+    for (i = 0; i < 8; i++) {
+        store_be32(digest + 4 * i, ctx->state[i]);
+    }
+}
+
+void host_sha256(const void *data, uint32_t length, uint8_t digest[32]) {
+    struct sha256_ctx ctx;
+
+    sha256_start(&ctx, sha256_backend->blocks);
+    sha256_update(&ctx, data, length);
+    sha256_final(&ctx, digest);
+}
+
+static void sha256_many_serial(const uint8_t *const data[],
+                               const uint32_t length[],
+                               uint8_t (*digest)[32], unsigned int count) {
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        host_sha256(data[i], length[i], digest[i]);
+    }
+}
+
+#ifdef HOST_CRYPTO_X86
+struct sha256_job {
+    const uint8_t *data;
+    uint32_t length;
+    unsigned int index;
+};
+
+static int sha256_job_compare(const void *a, const void *b) {
+    const struct sha256_job *ja = a;
+    const struct sha256_job *jb = b;
+
+    return (ja->length > jb->length) - (ja->length < jb->length);
+}
+
+/*
+ * The messages go eight at a time, shortest first, so that the lanes of a
+ * group run for about as many blocks. A lane whose message is done hashes
+ * a dummy block until the longest one in its group is.
+ */
+static void sha256_many_avx2(const uint8_t *const data[],
+                             const uint32_t length[],
+                             uint8_t (*digest)[32], unsigned int count) {
+    static const uint8_t idle[SHA256_BLOCK_SIZE];
+    uint8_t tail[SHA256_LANES][2 * SHA256_BLOCK_SIZE];
+    uint32_t state[8][SHA256_LANES];
+    const uint8_t *block[SHA256_LANES];
+    uint32_t whole[SHA256_LANES];
+    uint32_t total[SHA256_LANES];
+    const struct sha256_job *job;
+    struct sha256_job *jobs;
+    unsigned int first, lanes, l, i;
+    uint32_t b, most;
+
+    jobs = malloc(count * sizeof(*jobs));
+    if (!jobs) {
+        sha256_many_serial(data, length, digest, count);
+        return;
+    }
+    for (i = 0; i < count; i++) {
+        jobs[i].data = data[i];
+        jobs[i].length = length[i];
+        jobs[i].index = i;
+    }
+    qsort(jobs, count, sizeof(*jobs), sha256_job_compare);
+
+    for (first = 0; first < count; first += SHA256_LANES) {
+        lanes = count - first < SHA256_LANES ? count - first : SHA256_LANES;
+        most = 0;
+        for (l = 0; l < SHA256_LANES; l++) {
+            for (i = 0; i < 8; i++) {
+                state[i][l] = sha256_initial[i];
+            }
+            whole[l] = 0;
+            total[l] = 0;
+            if (l < lanes) {
+                job = &jobs[first + l];
+                whole[l] = job->length / SHA256_BLOCK_SIZE;
+                total[l] = whole[l] +
+                    sha256_tail(tail[l],
+                                job->data + whole[l] * SHA256_BLOCK_SIZE,
+                                job->length);
+                if (total[l] > most) {
+                    most = total[l];
+                }
+            }
+        }
+
+        for (b = 0; b < most; b++) {
+            for (l = 0; l < SHA256_LANES; l++) {
+                if (b < whole[l]) {
+                    block[l] = jobs[first + l].data + b * SHA256_BLOCK_SIZE;
+                } else if (b < total[l]) {
+                    block[l] = tail[l] + (b - whole[l]) * SHA256_BLOCK_SIZE;
+                } else {
+                    block[l] = idle;
+                }
+            }
+            sha256_x8_avx2(state, block);
+            for (l = 0; l < lanes; l++) {
+                if (total[l] == b + 1) {
+                    for (i = 0; i < 8; i++) {
+                        store_be32(digest[jobs[first + l].index] + 4 * i,
+                                   state[i][l]);
+                    }
+                }
+            }
+        }
+    }
+    free(jobs);
+}
+#endif /* HOST_CRYPTO_X86 */
+
+void host_sha256_many(const uint8_t *const data[], const uint32_t length[],
+                      uint8_t (*digest)[32], unsigned int count) {
+#ifdef HOST_CRYPTO_X86
+    if (use_avx2_many && count > 1) {
+        sha256_many_avx2(data, length, digest, count);
+        return;
+    }
+#endif
+    sha256_many_serial(data, length, digest, count);
+}
+
+/* The EMSA-PKCS1-v1_5 encoding of a SHA-256 digest that rsa_verify() wants */
+static void rsa_pkcs1_encoding(uint8_t em[PUBLIC_KEY_SIZE],
+                               const uint8_t digest[HASH_DIGEST_SIZE]) {
+    uint8_t *p = em + PUBLIC_KEY_SIZE - HASH_DIGEST_SIZE - sizeof(SHA256ID);
+
+    em[0] = 0x00;
+    em[1] = 0x01;
+    memset(em + 2, 0xff, p - 1 - (em + 2));
+    p[-1] = 0x00;
+    memcpy(p, SHA256ID, sizeof(SHA256ID));
+    memcpy(p + sizeof(SHA256ID), digest, HASH_DIGEST_SIZE);
+}
+
+#ifdef __SIZEOF_INT128__
+#define RSA_LIMBS               (PUBLIC_KEY_SIZE / 8)
+
+typedef unsigned __int128 rsa_dlimb;
+
+/*
+ * A modulus set up for Montgomery multiplication, with R = 2^2048. Only
+ * odd moduli of the full 2048 bits are; the others go to MIRACL.
+ */
+struct rsa_mont {
+    uint8_t key[PUBLIC_KEY_SIZE];   /* The public key it was set up for */
+    uint64_t n[RSA_LIMBS];          /* The modulus, least significant first */
+    uint64_t r2[RSA_LIMBS];         /* R^2 mod n */
+    uint64_t n0inv;                 /* -1/n mod 2^64, 0 if not set up */
+};
+
+static void rsa_from_bytes(uint64_t x[RSA_LIMBS], const uint8_t *bytes) {
+    int i, j;
+
+    for (i = 0; i < RSA_LIMBS; i++) {
+        x[i] = 0;
+        for (j = 0; j < 8; j++) {
+            x[i] |= (uint64_t)bytes[PUBLIC_KEY_SIZE - 1 - 8 * i - j] << (8 * j);
+        }
+    }
+}
+
+static void rsa_to_bytes(uint8_t *bytes, const uint64_t x[RSA_LIMBS]) {
+    int i, j;
+
+    for (i = 0; i < RSA_LIMBS; i++) {
+        for (j = 0; j < 8; j++) {
+            bytes[PUBLIC_KEY_SIZE - 1 - 8 * i - j] = x[i] >> (8 * j);
+        }
+    }
+}
+
+/* r = a - b, returning the borrow */
+static uint64_t rsa_sub(uint64_t r[RSA_LIMBS], const uint64_t a[RSA_LIMBS],
+                        const uint64_t b[RSA_LIMBS]) {
+    uint64_t borrow = 0;
+    rsa_dlimb d;
+    int i;
+
+    for (i = 0; i < RSA_LIMBS; i++) {
+        d = (rsa_dlimb)a[i] - b[i] - borrow;
+        r[i] = (uint64_t)d;
+        borrow = (uint64_t)(d >> 64) & 1;
+    }
+    return borrow;
+}
+
+/* x = (x + carry * 2^2048) mod n, for x + carry * 2^2048 < 2n */
+static void rsa_reduce(uint64_t x[RSA_LIMBS], uint64_t carry,
+                       const uint64_t n[RSA_LIMBS]) {
+    uint64_t t[RSA_LIMBS];
+    uint64_t borrow = rsa_sub(t, x, n);
+
+    if (carry || !borrow) {
+        memcpy(x, t, sizeof(t));
+    }
+}
+
+/* r = a * b / R mod n, for a, b < n, by coarsely integrated operand scanning */
+static void rsa_mont_mul(uint64_t r[RSA_LIMBS], const uint64_t a[RSA_LIMBS],
+                         const uint64_t b[RSA_LIMBS],
+                         const struct rsa_mont *m) {
+    uint64_t t[RSA_LIMBS + 2];
+    uint64_t c, q;
+    rsa_dlimb p;
+    int i, j;
+
+    memset(t, 0, sizeof(t));
+    for (i = 0; i < RSA_LIMBS; i++) {
+        c = 0;
+        for (j = 0; j < RSA_LIMBS; j++) {
+            p = (rsa_dlimb)a[j] * b[i] + t[j] + c;
+            t[j] = (uint64_t)p;
+            c = p >> 64;
+        }
+        p = (rsa_dlimb)t[RSA_LIMBS] + c;
+        t[RSA_LIMBS] = (uint64_t)p;
+        t[RSA_LIMBS + 1] = p >> 64;
+
+        /* Add q * n to clear the bottom limb, and shift it out */
+        q = t[0] * m->n0inv;
+        p = (rsa_dlimb)q * m->n[0] + t[0];
+        c = p >> 64;
+        for (j = 1; j < RSA_LIMBS; j++) {
+            p = (rsa_dlimb)q * m->n[j] + t[j] + c;
+            t[j - 1] = (uint64_t)p;
+            c = p >> 64;
+        }
+        p = (rsa_dlimb)t[RSA_LIMBS] + c;
+        t[RSA_LIMBS - 1] = (uint64_t)p;
+        t[RSA_LIMBS] = t[RSA_LIMBS + 1] + (uint64_t)(p >> 64);
+    }
+    rsa_reduce(t, t[RSA_LIMBS], m->n);
+    memcpy(r, t, RSA_LIMBS * sizeof(uint64_t));
+}
+
+/**
+ * @brief Set up a modulus for rsa_pow65537(), unless it already is
+ * @param m The set-up modulus
+ * @param key The public key
+ * @return true if it can be used, false if the key is MIRACL's to check
+ */
+static bool rsa_mont_setup(struct rsa_mont *m, const uint8_t *key) {
+    uint64_t carry, inv;
+    int i, j;
+
+    if (!(key[0] & 0x80) || !(key[PUBLIC_KEY_SIZE - 1] & 1)) {
+        return false;
+    }
+    if (m->n0inv && memcmp(m->key, key, PUBLIC_KEY_SIZE) == 0) {
+        return true;
+    }
+
+    memcpy(m->key, key, PUBLIC_KEY_SIZE);
+    rsa_from_bytes(m->n, key);
+
+    /* Newton's iteration doubles the bits of 1/n right each time */
+    inv = m->n[0];
+    for (i = 0; i < 5; i++) {
+        inv *= 2 - m->n[0] * inv;
+    }
+    m->n0inv = -inv;
+
+    /*
+     * R mod n is 2^2048 - n, with the top bit of n set. Doubled 64 times,
+     * it is 2^64 in Montgomery form, which five squarings take to 2^2048:
+     * R^2 mod n.
+     */
+    memset(m->r2, 0, sizeof(m->r2));
+    rsa_sub(m->r2, m->r2, m->n);
+    for (i = 0; i < 64; i++) {
+        carry = m->r2[RSA_LIMBS - 1] >> 63;
+        for (j = RSA_LIMBS - 1; j > 0; j--) {
+            m->r2[j] = (m->r2[j] << 1) | (m->r2[j - 1] >> 63);
+        }
+        m->r2[0] <<= 1;
+        rsa_reduce(m->r2, carry, m->n);
+    }
+    for (i = 0; i < 5; i++) {
+        rsa_mont_mul(m->r2, m->r2, m->r2, m);
+    }
+    return true;
+}
+
+/* c = s^65537 mod n, as MIRACL's tr_rsa_pow() */
+static void rsa_pow65537(const struct rsa_mont *m, const uint8_t *signature,
+                         uint8_t c[PUBLIC_KEY_SIZE]) {
+    static const uint64_t one[RSA_LIMBS] = { 1 };
+    uint64_t s[RSA_LIMBS];
+    uint64_t x[RSA_LIMBS];
+    int i;
+
+    /* Any s below 2^2048 is below 2n */
+    rsa_from_bytes(s, signature);
+    rsa_reduce(s, 0, m->n);
+
+    rsa_mont_mul(s, s, m->r2, m);
+    memcpy(x, s, sizeof(x));
+    for (i = 0; i < 16; i++) {
+        rsa_mont_mul(x, x, x, m);
+    }
+    rsa_mont_mul(x, x, s, m);
+    rsa_mont_mul(x, x, one, m);
+    rsa_to_bytes(c, x);
+}
+#endif /* __SIZEOF_INT128__ */
+
+static int reference_rsa2048_verify(const unsigned char *digest,
+                                    const unsigned char *public_key,
+                                    const unsigned char *signature) {
+    return rsa2048_verify_func((char *)digest, (char *)public_key,
+                               (char *)signature);
+}
+
+static int fast_rsa2048_verify(const unsigned char *digest,
+                               const unsigned char *public_key,
+                               const unsigned char *signature) {
+#ifdef __SIZEOF_INT128__
+    /* The boot ROM checks against a handful of keys; keep the last */
+    static struct rsa_mont key;
+    uint8_t em[PUBLIC_KEY_SIZE];
+    uint8_t c[PUBLIC_KEY_SIZE];
+
+    if (rsa_mont_setup(&key, public_key)) {
+        rsa_pow65537(&key, signature, c);
+        rsa_pkcs1_encoding(em, digest);
+        return memcmp(c, em, PUBLIC_KEY_SIZE) == 0;
+    }
+#endif
+    return reference_rsa2048_verify(digest, public_key, signature);
+}
+
+/* crypto.c's hash, run through both in --crypto check */
+static struct sha256_ctx fast_ctx;
+static sha256 reference_ctx;
+
+static bool use_fast(void) {
+    return host_config.crypto != HOST_CRYPTO_REFERENCE;
+}
+
+static bool use_reference(void) {
+    return host_config.crypto == HOST_CRYPTO_REFERENCE ||
+           host_config.crypto == HOST_CRYPTO_CHECK;
+}
+
+static void crypto_mismatch(const char *what) {
+    fprintf(stderr, "crypto check: %s differs between %s and MIRACL\n",
+            what, sha256_backend->name);
+    abort();
+}
+
+void chip_crypto_init(void) {
+    unsigned int i;
+
+    sha256_backend = &sha256_backends[SHA256_BACKENDS - 1];
+    use_avx2_many = false;
+    if (host_config.crypto == HOST_CRYPTO_GENERIC) {
+        return;
+    }
+
+    for (i = 0; !sha256_backends[i].supported(); i++) {
+        ;
+    }
+    sha256_backend = &sha256_backends[i];
+#ifdef HOST_CRYPTO_X86
+    /* The SHA extensions hash one message faster than AVX2 does eight */
+    use_avx2_many = sha256_backend->blocks == sha256_blocks_generic &&
+                    cpu_has_avx2();
+#endif
+}
+
+void chip_hash_start(void) {
+    if (use_fast()) {
+        sha256_start(&fast_ctx, sha256_backend->blocks);
+    }
+    if (use_reference()) {
+        sha256_init_func(&reference_ctx);
+    }
+}
+
+void chip_hash_update(const unsigned char *data, uint32_t datalen) {
+    uint32_t i;
+
+    if (use_fast()) {
+        sha256_update(&fast_ctx, data, datalen);
+    }
+    if (use_reference()) {
+        for (i = 0; i < datalen; i++) {
+            sha256_process_func(&reference_ctx, data[i]);
+        }
+    }
+}
+
+void chip_hash_final(unsigned char *digest) {
+    unsigned char reference[HASH_DIGEST_SIZE];
+
+    if (!use_fast()) {
+        sha256_hash_func(&reference_ctx, (char *)digest);
+        return;
+    }
+    sha256_final(&fast_ctx, digest);
+    if (use_reference()) {
+        sha256_hash_func(&reference_ctx, (char *)reference);
+        if (memcmp(digest, reference, sizeof(reference)) != 0) {
+            crypto_mismatch("SHA-256");
+        }
+    }
+}
+
+int chip_rsa2048_verify(const unsigned char *digest,
+                        const unsigned char *public_key,
+                        const unsigned char *signature) {
+    int ret;
+
+    if (!use_fast()) {
+        return reference_rsa2048_verify(digest, public_key, signature);
+    }
+    ret = fast_rsa2048_verify(digest, public_key, signature);
+    if (use_reference() &&
+        ret != reference_rsa2048_verify(digest, public_key, signature)) {
+        crypto_mismatch("RSA-2048 verification");
+    }
+    return ret;
+}
+
+int host_crypto_set_mode(const char *name) {
+    static const char *const names[] = {
+        [HOST_CRYPTO_AUTO] = "auto",
+        [HOST_CRYPTO_GENERIC] = "generic",
+        [HOST_CRYPTO_REFERENCE] = "reference",
+        [HOST_CRYPTO_CHECK] = "check",
+    };
+    unsigned int i;
+
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcasecmp(name, names[i]) == 0) {
+            host_config.crypto = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*
+ * --crypto-test: every SHA-256 backend the CPU has, host_sha256_many() and
+ * the RSA exponentiation against MIRACL, on fixed-seed random inputs
+ */
+#define TEST_MAX_LENGTH         20000
+#define TEST_MANY_MAX           20
+
+static uint64_t test_seed = 0x2545f4914f6cdd1dULL;
+static unsigned int test_checks;
+static unsigned int test_failures;
+
+static uint32_t test_random(void) {
+    test_seed ^= test_seed >> 12;
+    test_seed ^= test_seed << 25;
+    test_seed ^= test_seed >> 27;
+    return (test_seed * 0x2545f4914f6cdd1dULL) >> 32;
+}
+
+static void test_fill(uint8_t *p, size_t length) {
+    while (length--) {
+        *p++ = test_random();
+    }
+}
+
+static void test_check(bool ok, const char *what, const char *backend,
+                       uint32_t length) {
+    test_checks++;
+    if (!ok) {
+        if (test_failures++ < 10) {
+            fprintf(stderr, "crypto test: %s: %s differs from MIRACL (%u)\n",
+                    backend, what, length);
+        }
+    }
+}
+
+static void test_sha256(const uint8_t *data, uint32_t length) {
+    uint8_t reference[HASH_DIGEST_SIZE];
+    uint8_t digest[HASH_DIGEST_SIZE];
+    struct sha256_ctx ctx;
+    const struct sha256_backend *backend;
+    uint32_t done, n;
+    unsigned int i;
+
+    hashit((char *)data, length, (char *)reference);
+
+    for (i = 0; i < SHA256_BACKENDS; i++) {
+        backend = &sha256_backends[i];
+        if (!backend->supported()) {
+            continue;
+        }
+
+        sha256_start(&ctx, backend->blocks);
+        sha256_update(&ctx, data, length);
+        sha256_final(&ctx, digest);
+        test_check(memcmp(digest, reference, sizeof(digest)) == 0,
+                   "SHA-256", backend->name, length);
+
+        /* In pieces, as the loaders hash a section at a time */
+        sha256_start(&ctx, backend->blocks);
+        for (done = 0; done < length; done += n) {
+            n = test_random() % (2 * SHA256_BLOCK_SIZE + 1);
+            if (n > length - done) {
+                n = length - done;
+            }
+            sha256_update(&ctx, data + done, n);
+        }
+        sha256_final(&ctx, digest);
+        test_check(memcmp(digest, reference, sizeof(digest)) == 0,
+                   "SHA-256 in pieces", backend->name, length);
+    }
+}
+
+static void test_sha256_many(const uint8_t *buf) {
+    const uint8_t *data[TEST_MANY_MAX];
+    uint32_t length[TEST_MANY_MAX];
+    uint8_t reference[TEST_MANY_MAX][HASH_DIGEST_SIZE];
+    uint8_t digest[TEST_MANY_MAX][HASH_DIGEST_SIZE];
+    unsigned int count = 1 + test_random() % TEST_MANY_MAX;
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        /* Some the same length, some empty, some many blocks apart */
+        length[i] = test_random() % 4 ? test_random() % 2000 : length[0];
+        data[i] = buf + test_random() % (TEST_MAX_LENGTH - length[i] + 1);
+        hashit((char *)data[i], length[i], (char *)reference[i]);
+    }
+
+    sha256_many_serial(data, length, digest, count);
+    test_check(memcmp(digest, reference, count * HASH_DIGEST_SIZE) == 0,
+               "host_sha256_many()", sha256_backend->name, count);
+#ifdef HOST_CRYPTO_X86
+    if (cpu_has_avx2()) {
+        sha256_many_avx2(data, length, digest, count);
+        test_check(memcmp(digest, reference, count * HASH_DIGEST_SIZE) == 0,
+                   "host_sha256_many()", "avx2", count);
+    }
+#endif
+}
+
+static void reference_pow65537(const uint8_t *key, const uint8_t *signature,
+                               uint8_t c[PUBLIC_KEY_SIZE]) {
+    BIG n[MODSIZE], s[MODSIZE], x[MODSIZE];
+    int i;
+
+    tr_convert((char *)key, n);
+    tr_convert((char *)signature, s);
+    tr_rsa_pow(n, s, x);
+    for (i = 0; i < RSABYTES; i++) {
+        c[RSABYTES - 1 - i] = x[i / REGBYTES] >> (8 * (i % REGBYTES));
+    }
+}
+
+static void test_rsa(const uint8_t *key) {
+    uint8_t signature[PUBLIC_KEY_SIZE];
+    uint8_t digest[HASH_DIGEST_SIZE];
+    uint8_t em[PUBLIC_KEY_SIZE];
+    uint8_t reference[PUBLIC_KEY_SIZE];
+    unsigned int i;
+#ifdef __SIZEOF_INT128__
+    struct rsa_mont m = { .n0inv = 0 };
+    uint8_t c[PUBLIC_KEY_SIZE];
+    bool fast = rsa_mont_setup(&m, key);
+#endif
+
+    test_fill(digest, sizeof(digest));
+    rsa_pkcs1_encoding(em, digest);
+    pkcs_v15((char *)digest, (char *)reference);
+    test_check(memcmp(em, reference, sizeof(em)) == 0,
+               "PKCS #1 encoding", "rsa", 0);
+
+    /* Random, 0, 1, n - 1, n and 2^2048 - 1 */
+    for (i = 0; i < 6; i++) {
+        switch (i) {
+        case 0:
+            test_fill(signature, sizeof(signature));
+            break;
+        case 1:
+        case 2:
+            memset(signature, 0, sizeof(signature));
+            signature[PUBLIC_KEY_SIZE - 1] = i - 1;
+            break;
+        case 3:
+        case 4:
+            memcpy(signature, key, sizeof(signature));
+            signature[PUBLIC_KEY_SIZE - 1] -= 4 - i;
+            break;
+        default:
+            memset(signature, 0xff, sizeof(signature));
+            break;
+        }
+
+#ifdef __SIZEOF_INT128__
+        if (fast) {
+            reference_pow65537(key, signature, reference);
+            rsa_pow65537(&m, signature, c);
+            test_check(memcmp(c, reference, sizeof(c)) == 0,
+                       "signature^65537 mod n", "rsa", i);
+        }
+#endif
+        test_check(fast_rsa2048_verify(digest, key, signature) ==
+                   reference_rsa2048_verify(digest, key, signature),
+                   "RSA-2048 verification", "rsa", i);
+    }
+}
+
+int host_crypto_test(unsigned int rounds) {
+    uint8_t key[PUBLIC_KEY_SIZE];
+    const struct sha256_backend *backend;
+    uint8_t *buf;
+    uint32_t length;
+    unsigned int i;
+
+    buf = malloc(TEST_MAX_LENGTH);
+    if (!buf) {
+        return -1;
+    }
+    test_fill(buf, TEST_MAX_LENGTH);
+
+    for (i = 0; i < SHA256_BACKENDS; i++) {
+        backend = &sha256_backends[i];
+        printf("sha256 %s: %s\n", backend->name,
+               backend->supported() ? "testing" : "not on this CPU");
+    }
+#ifdef HOST_CRYPTO_X86
+    printf("sha256 avx2 x%u: %s\n", SHA256_LANES,
+           cpu_has_avx2() ? "testing" : "not on this CPU");
+#endif
+
+    /* Every length around the padding boundaries, then random ones */
+    for (length = 0; length <= 3 * SHA256_BLOCK_SIZE; length++) {
+        test_sha256(buf + test_random() % 64, length);
+    }
+    for (i = 0; i < rounds; i++) {
+        length = test_random() % (TEST_MAX_LENGTH - 64);
+        test_sha256(buf + test_random() % 64, length);
+        test_sha256_many(buf);
+    }
+
+    /* The keys built in, and random full-size moduli, odd or not */
+    for (i = 0; i < number_of_public_keys; i++) {
+        test_rsa(public_keys[i].key);
+    }
+    for (i = 0; i < rounds; i++) {
+        test_fill(key, sizeof(key));
+        key[0] |= 0x80;
+        if (i % 8) {
+            key[PUBLIC_KEY_SIZE - 1] |= 1;
+        }
+        test_rsa(key);
+    }
+
+    free(buf);
+    printf("crypto test: %u checks, %u failed\n", test_checks, test_failures);
+    return test_failures ? -1 : 0;
+}
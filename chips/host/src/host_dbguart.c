@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Debug "UART" for the host build: the output goes to stdout, which stdio
+ * buffers much as the TX ring does on the chip.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include "chipapi.h"
+
+void chip_dbginit(void) {
+#ifdef BUILD_FOR_GBBOOT_SERVER
+    /* The server runs until it's killed, so don't sit on its log */
+    setvbuf(stdout, NULL, _IOLBF, 0);
+#endif
+}
+
+void chip_dbgpoll(void) {
+}
+
+void chip_dbgputc(int c) {
+    putchar(c);
+}
+
+unsigned int chip_dbgtrywrite(const uint8_t *buf, unsigned int len) {
+    /* stdout always has room: all of buf or, on an error, none of it */
+    return fwrite(buf, 1, len, stdout) == len ? len : 0;
+}
+
+void chip_dbgflush(void) {
+    fflush(stdout);
+}
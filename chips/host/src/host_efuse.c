@@ -0,0 +1,75 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * The bootstrap pins and e-Fuses, as set on the host_main command line. These
+ * feed the ES3 e-Fuse validation in es3_efuse.c.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "host.h"
+#include "tsb_scm.h"
+#include "tsb_isaa.h"
+
+uint32_t tsb_get_bootselector(void) {
+    return host_config.boot_over_unipro ? TSB_EBOOTSELECTOR_SPIBOOT_N : 0;
+}
+
+uint32_t tsb_get_eccerror(void) {
+    return host_config.efuse_ecc_error ? TSB_ECCERROR_ECC_ERROR : 0;
+}
+
+uint32_t tsb_get_vid(void) {
+    return host_config.efuse_vid;
+}
+
+uint32_t tsb_get_pid(void) {
+    return host_config.efuse_pid;
+}
+
+/* Once access is disabled, the IMS reads back as zeroes */
+static bool ims_disabled;
+
+void tsb_get_ims(uint8_t *buf, uint32_t size) {
+    if (size > sizeof(host_config.ims)) {
+        size = sizeof(host_config.ims);
+    }
+    if (ims_disabled) {
+        memset(buf, 0, size);
+    } else {
+        memcpy(buf, host_config.ims, size);
+    }
+}
+
+void tsb_disable_ims_access(void) {
+    ims_disabled = true;
+}
+
+void tsb_disable_cms_access(void) {
+}
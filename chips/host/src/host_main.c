@@ -0,0 +1,409 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Entry point for the native Linux build of the boot ROM
+ *
+ * main() stands in for boot.S: it maps workram at its ES3 address, clears it
+ * the way a cold or warm reset would, and calls bootrom_main(). The rest of
+ * the chip is simulated by the other host_*.c files, configured from the
+ * command line.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "host.h"
+#include "chipdef.h"
+#include "bootrom.h"
+#include "crypto.h"
+#include "unipro.h"
+
+HOST_LINKER_SYMBOL(_workram_start, WORKRAM_BASE);
+HOST_LINKER_SYMBOL(_workram_end, HOST_WORKRAM_END);
+HOST_LINKER_SYMBOL(_communication_area, HOST_COMMUNICATION_AREA);
+HOST_LINKER_SYMBOL(_warm_boot_record, HOST_COMMUNICATION_AREA);
+HOST_LINKER_SYMBOL(_bootrom_data_area, HOST_COMMUNICATION_AREA);
+
+void bootrom_main(void);
+
+struct host_config host_config = {
+    .spi_size = 16 * 1024 * 1024,
+    .spi_clock_khz = 24000, /* As es3_spi.c sets it up */
+    .spi_width = 1,
+    .cpu_mhz = 48,
+    .unipro_mid = 0x0126,   /* Toshiba */
+    .unipro_pid = 0x1000,
+    .hs_series = PA_HS_SERIES_A,
+    .max_hs_gear = 3,
+    .replay_speed = 1,
+};
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -s, --spi FILE        SPI flash image (default: blank flash)\n"
+            "      --spi-size BYTES  flash capacity (default 16M)\n"
+            "      --spi-clock KHZ   SPI clock, 0 for no transfer time\n"
+            "                        (default 24000)\n"
+            "      --spi-width N     data lines for reads, 1, 2 or 4\n"
+            "                        (default 1)\n"
+            "      --spi-overhead NS controller time per command (default 0)\n"
+            "      --spi-stats       report the SPI traffic\n"
+            "  -t, --timeline        print the boot timeline on exit\n"
+            "  -u, --unipro          boot selector set for boot over UniPro\n"
+            "  -w, --workram FILE    keep workram in FILE, so that a later\n"
+            "                        run can warm boot\n"
+            "  -c, --clock MHZ       CPU clock for cycle counts (default 48)\n"
+            "      --unipro-mid ID   DME_DDBL1_MANUFACTURERID (default 0x126)\n"
+            "      --unipro-pid ID   DME_DDBL1_PRODUCTID (default 0x1000)\n"
+            "  -l, --link FILE       share the UniPro link with the process\n"
+            "                        at the other end through FILE\n"
+            "      --link-mbps MBPS  link bandwidth, 0 for unlimited\n"
+            "                        (default 0)\n"
+            "      --link-latency NS one-way link delay (default 0)\n"
+            "      --hs-gear N       move the link to HS gear N, 1-3, before\n"
+            "                        a UniPro download (default 0: stay in\n"
+            "                        the slow mode, at --link-mbps)\n"
+            "      --hs-series S     HS series, A or B (default A)\n"
+            "      --max-hs-gear N   highest HS gear this end receives in,\n"
+            "                        PA_MAXRXHSGEAR (default 3)\n"
+#ifdef _CAPTURE
+            "      --capture FILE    write the Greybus capture log to FILE\n"
+#endif
+            "      --replay FILE     play the AP's side of a captured\n"
+            "                        session instead of a link\n"
+            "      --replay-speed N  divide the recorded delays by N, 0 for\n"
+            "                        no delays (default 1)\n"
+            "      --vid VID         Ara VID e-Fuse (default 0)\n"
+            "      --pid PID         Ara PID e-Fuse (default 0)\n"
+            "      --scr BITS        key revocation e-Fuse bits (default 0)\n"
+            "      --ims HEX         IMS e-Fuse bytes, in hex (default 0)\n"
+            "      --ecc-error       fail the e-Fuse ECC check\n"
+            "      --crypto MODE     SHA-256 and RSA code: auto, generic,\n"
+            "                        reference (MIRACL, as on the chip) or\n"
+            "                        check (both, compared) (default auto)\n"
+            "      --crypto-test N   check the host's SHA-256 and RSA code\n"
+            "                        against MIRACL's, with N random inputs\n"
+            "                        on top of the fixed ones, and exit\n"
+            "Exits 0 when the boot ROM jumps to an image, 1 if it halts.\n",
+            name);
+}
+
+static uint32_t parse_u32(const char *name, const char *arg) {
+    char *end;
+    unsigned long val = strtoul(arg, &end, 0);
+
+    if (*arg == '\0' || *end != '\0' || val > UINT32_MAX) {
+        fprintf(stderr, "bad %s: %s\n", name, arg);
+        exit(2);
+    }
+    return val;
+}
+
+static void parse_ims(const char *arg) {
+    unsigned int i;
+    unsigned int byte;
+
+    for (i = 0; i < sizeof(host_config.ims) && arg[0] && arg[1]; i++) {
+        if (sscanf(arg, "%2x", &byte) != 1) {
+            break;
+        }
+        host_config.ims[i] = byte;
+        arg += 2;
+    }
+    if (*arg != '\0') {
+        fprintf(stderr, "bad IMS: at most %u hex bytes\n",
+                (unsigned int)sizeof(host_config.ims));
+        exit(2);
+    }
+}
+
+/**
+ * @brief Map workram at the address the ROM code expects
+ *
+ * A workram file keeps the image and the communication area across runs,
+ * like workram keeps them across a warm reset. Only the ROM's own area is
+ * cleared then, unless there is no armed warm-boot record, as in boot.S.
+ * Without CONFIG_WARM_BOOT, workram is always cleared.
+ */
+static void map_workram(void) {
+    int flags = MAP_FIXED_NOREPLACE;
+    int fd = -1;
+    void *p;
+#ifdef CONFIG_WARM_BOOT
+    warm_boot_record *record;
+#endif
+
+    if (host_config.workram_file) {
+        fd = open(host_config.workram_file, O_RDWR | O_CREAT, 0644);
+        if (fd < 0 || ftruncate(fd, WORKRAM_SIZE) < 0) {
+            perror(host_config.workram_file);
+            exit(2);
+        }
+        flags |= MAP_SHARED;
+    } else {
+        flags |= MAP_PRIVATE | MAP_ANONYMOUS;
+    }
+
+    p = mmap((void *)WORKRAM_BASE, WORKRAM_SIZE, PROT_READ | PROT_WRITE,
+             flags, fd, 0);
+    if (p != (void *)WORKRAM_BASE) {
+        perror("mapping workram");
+        exit(2);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+#ifdef CONFIG_WARM_BOOT
+    record = (warm_boot_record *)HOST_COMMUNICATION_AREA;
+    if (record->marker == ~record->marker_complement) {
+        return;
+    }
+#endif
+    memset(p, 0, WORKRAM_SIZE);
+}
+
+int main(int argc, char *argv[]) {
+    enum {
+        OPT_SPI_SIZE = 256,
+        OPT_SPI_CLOCK,
+        OPT_SPI_WIDTH,
+        OPT_SPI_OVERHEAD,
+        OPT_SPI_STATS,
+        OPT_UNIPRO_MID,
+        OPT_UNIPRO_PID,
+        OPT_LINK_MBPS,
+        OPT_LINK_LATENCY,
+        OPT_HS_GEAR,
+        OPT_HS_SERIES,
+        OPT_MAX_HS_GEAR,
+        OPT_CAPTURE,
+        OPT_REPLAY,
+        OPT_REPLAY_SPEED,
+        OPT_VID,
+        OPT_PID,
+        OPT_SCR,
+        OPT_IMS,
+        OPT_ECC_ERROR,
+        OPT_CRYPTO,
+        OPT_CRYPTO_TEST,
+    };
+    static const struct option options[] = {
+        { "spi", required_argument, NULL, 's' },
+        { "spi-size", required_argument, NULL, OPT_SPI_SIZE },
+        { "spi-clock", required_argument, NULL, OPT_SPI_CLOCK },
+        { "spi-width", required_argument, NULL, OPT_SPI_WIDTH },
+        { "spi-overhead", required_argument, NULL, OPT_SPI_OVERHEAD },
+        { "spi-stats", no_argument, NULL, OPT_SPI_STATS },
+        { "timeline", no_argument, NULL, 't' },
+        { "unipro", no_argument, NULL, 'u' },
+        { "workram", required_argument, NULL, 'w' },
+        { "clock", required_argument, NULL, 'c' },
+        { "unipro-mid", required_argument, NULL, OPT_UNIPRO_MID },
+        { "unipro-pid", required_argument, NULL, OPT_UNIPRO_PID },
+        { "link", required_argument, NULL, 'l' },
+        { "link-mbps", required_argument, NULL, OPT_LINK_MBPS },
+        { "link-latency", required_argument, NULL, OPT_LINK_LATENCY },
+        { "hs-gear", required_argument, NULL, OPT_HS_GEAR },
+        { "hs-series", required_argument, NULL, OPT_HS_SERIES },
+        { "max-hs-gear", required_argument, NULL, OPT_MAX_HS_GEAR },
+#ifdef _CAPTURE
+        { "capture", required_argument, NULL, OPT_CAPTURE },
+#endif
+        { "replay", required_argument, NULL, OPT_REPLAY },
+        { "replay-speed", required_argument, NULL, OPT_REPLAY_SPEED },
+        { "vid", required_argument, NULL, OPT_VID },
+        { "pid", required_argument, NULL, OPT_PID },
+        { "scr", required_argument, NULL, OPT_SCR },
+        { "ims", required_argument, NULL, OPT_IMS },
+        { "ecc-error", no_argument, NULL, OPT_ECC_ERROR },
+        { "crypto", required_argument, NULL, OPT_CRYPTO },
+        { "crypto-test", required_argument, NULL, OPT_CRYPTO_TEST },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+    bool crypto_test = false;
+    uint32_t crypto_test_rounds = 0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "s:tuw:c:l:h", options,
+                              NULL)) != -1) {
+        switch (opt) {
+        case 's':
+            host_config.spi_image = optarg;
+            break;
+        case OPT_SPI_SIZE:
+            host_config.spi_size = parse_u32("SPI flash size", optarg);
+            break;
+        case OPT_SPI_CLOCK:
+            host_config.spi_clock_khz = parse_u32("SPI clock", optarg);
+            break;
+        case OPT_SPI_WIDTH:
+            host_config.spi_width = parse_u32("SPI width", optarg);
+            if (host_config.spi_width != 1 && host_config.spi_width != 2 &&
+                host_config.spi_width != 4) {
+                fprintf(stderr, "bad SPI width: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_SPI_OVERHEAD:
+            host_config.spi_overhead_ns = parse_u32("SPI overhead", optarg);
+            break;
+        case OPT_SPI_STATS:
+            host_config.spi_stats = true;
+            break;
+        case 't':
+            host_config.timeline_report = true;
+            break;
+        case 'u':
+            host_config.boot_over_unipro = true;
+            break;
+        case 'w':
+            host_config.workram_file = optarg;
+            break;
+        case 'c':
+            host_config.cpu_mhz = parse_u32("clock", optarg);
+            if (host_config.cpu_mhz == 0) {
+                fprintf(stderr, "bad clock: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_UNIPRO_MID:
+            host_config.unipro_mid = parse_u32("UniPro MID", optarg);
+            break;
+        case OPT_UNIPRO_PID:
+            host_config.unipro_pid = parse_u32("UniPro PID", optarg);
+            break;
+        case 'l':
+            host_config.link_path = optarg;
+            break;
+        case OPT_LINK_MBPS:
+            host_config.link_mbps = parse_u32("link bandwidth", optarg);
+            break;
+        case OPT_LINK_LATENCY:
+            host_config.link_latency_ns = parse_u32("link latency", optarg);
+            break;
+        case OPT_HS_GEAR:
+            host_config.hs_gear = parse_u32("HS gear", optarg);
+            if (host_config.hs_gear > 3) {
+                fprintf(stderr, "bad HS gear: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_HS_SERIES:
+            if ((optarg[0] == 'A' || optarg[0] == 'a') && !optarg[1]) {
+                host_config.hs_series = PA_HS_SERIES_A;
+            } else if ((optarg[0] == 'B' || optarg[0] == 'b') && !optarg[1]) {
+                host_config.hs_series = PA_HS_SERIES_B;
+            } else {
+                fprintf(stderr, "bad HS series: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_MAX_HS_GEAR:
+            host_config.max_hs_gear = parse_u32("max HS gear", optarg);
+            break;
+        case OPT_CAPTURE:
+            host_config.capture_file = optarg;
+            break;
+        case OPT_REPLAY:
+            host_config.replay_file = optarg;
+            break;
+        case OPT_REPLAY_SPEED:
+            host_config.replay_speed = parse_u32("replay speed", optarg);
+            break;
+        case OPT_VID:
+            host_config.efuse_vid = parse_u32("VID", optarg);
+            break;
+        case OPT_PID:
+            host_config.efuse_pid = parse_u32("PID", optarg);
+            break;
+        case OPT_SCR:
+            host_config.efuse_scr = parse_u32("SCR", optarg);
+            break;
+        case OPT_IMS:
+            parse_ims(optarg);
+            break;
+        case OPT_ECC_ERROR:
+            host_config.efuse_ecc_error = true;
+            break;
+        case OPT_CRYPTO:
+            if (host_crypto_set_mode(optarg)) {
+                fprintf(stderr, "bad crypto mode: %s\n", optarg);
+                return 2;
+            }
+            break;
+        case OPT_CRYPTO_TEST:
+            crypto_test = true;
+            crypto_test_rounds = parse_u32("crypto test rounds", optarg);
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind != argc) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (host_config.replay_file && host_config.link_path) {
+        fprintf(stderr, "--replay stands in for the link, not both\n");
+        return 2;
+    }
+
+    if (crypto_test) {
+        /* crypto_init() publishes MIRACL in the communication area */
+        map_workram();
+        crypto_init();
+        return host_crypto_test(crypto_test_rounds) ? 1 : 0;
+    }
+
+    if (host_spi_open() || host_unipro_open()) {
+        return 2;
+    }
+    map_workram();
+    bootrom_main();
+
+#ifdef BUILD_FOR_BENCH
+    /* The benchmarks come back once they have reported */
+    return 0;
+#else
+    /* bootrom_main() leaves through host_exit() */
+    return 1;
+#endif
+}
@@ -0,0 +1,291 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * SPI flash for the host build: the image file given with --spi, mapped into
+ * a flash-sized buffer, with the rest of the flash erased.
+ *
+ * Reads follow the ES3 driver: one read command per load for the whole
+ * words and another for any trailing bytes, 24-bit addresses, and at most
+ * 64k words per command. The flash itself wraps addresses at its capacity.
+ * Each command takes the time the bus would need for it, spent busy-waiting
+ * so that it shows up in the boot timeline as it would on the chip:
+ *
+ *   overhead + (opcode + address + dummy clocks + 8 * bytes / width) / clock
+ *
+ * The opcode and address always go out on one line. The dual and quad
+ * output reads add 8 dummy clocks.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "host.h"
+#include "chipapi.h"
+#include "debug.h"
+#include "data_loading.h"
+#include "crypto.h"
+
+#define SPI_ADDRESS_MASK        0x00FFFFFF
+#define SPI_ERASED_BYTE         0xFF
+#define SPI_MAX_FRAMES          0x10000 /* 32-bit frames per command */
+
+#define SPI_OPCODE_CLOCKS       8
+#define SPI_ADDRESS_CLOCKS      24
+#define SPI_FAST_READ_DUMMY     8       /* For the dual and quad reads */
+
+/* Program and erase, with typical NOR timings */
+#define SPI_PAGE_SIZE           256
+#define SPI_ERASE_BLOCK_SIZE    4096
+#define SPI_PAGE_PROGRAM_NS     700000
+#define SPI_BLOCK_ERASE_NS      45000000
+
+static uint8_t *flash;
+static uint32_t current_addr;
+
+/* Traffic since init, for --spi-stats */
+static uint32_t spi_commands;
+static uint32_t spi_bytes;
+static uint64_t spi_bus_ns;
+
+int host_spi_open(void) {
+    uint32_t size = host_config.spi_size;
+    struct stat st;
+    int fd;
+
+    if (size == 0 || size > SPI_ADDRESS_MASK + 1 || (size & (size - 1))) {
+        fprintf(stderr, "bad SPI flash size: %u\n", size);
+        return -1;
+    }
+
+    flash = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (flash == MAP_FAILED) {
+        perror("mapping SPI flash");
+        return -1;
+    }
+    memset(flash, SPI_ERASED_BYTE, size);
+
+    if (!host_config.spi_image) {
+        return 0;
+    }
+
+    /*
+     * Map the image over the start of the flash. It is private, so that
+     * programming and erasing leave the file alone.
+     */
+    fd = open(host_config.spi_image, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(host_config.spi_image);
+        return -1;
+    }
+    if ((uint64_t)st.st_size > size) {
+        fprintf(stderr, "%s: bigger than the %u byte flash\n",
+                host_config.spi_image, size);
+        return -1;
+    }
+    if (st.st_size > 0) {
+        if (mmap(flash, st.st_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            perror(host_config.spi_image);
+            return -1;
+        }
+        /* The rest of the last page maps as zeroes, not erased flash */
+        memset(flash + st.st_size, SPI_ERASED_BYTE,
+               (-st.st_size) & (sysconf(_SC_PAGESIZE) - 1));
+    }
+    close(fd);
+    return 0;
+}
+
+void host_spi_close(void) {
+    if (flash) {
+        munmap(flash, host_config.spi_size);
+        flash = NULL;
+    }
+}
+
+/**
+ * @brief Account for one read command and return when the bus would be done
+ * @param start host_now_ns() when the command started
+ * @param length Number of data bytes read
+ */
+static void spi_read_command(uint64_t start, uint32_t length) {
+    uint64_t clocks = SPI_OPCODE_CLOCKS + SPI_ADDRESS_CLOCKS;
+    uint64_t ns = host_config.spi_overhead_ns;
+
+    if (host_config.spi_width > 1) {
+        clocks += SPI_FAST_READ_DUMMY;
+    }
+    clocks += (uint64_t)length * 8 / host_config.spi_width;
+    if (host_config.spi_clock_khz) {
+        ns += clocks * 1000000 / host_config.spi_clock_khz;
+    }
+
+    spi_commands++;
+    spi_bytes += length;
+    spi_bus_ns += ns;
+    host_wait_until_ns(start + ns);
+}
+
+/**
+ * @brief Copy out of the flash from current_addr, wrapping at its end
+ */
+static void spi_copy(unsigned char *dest, uint32_t length) {
+    uint32_t mask = host_config.spi_size - 1;
+    uint32_t chunk;
+
+    while (length > 0) {
+        current_addr &= SPI_ADDRESS_MASK;
+        chunk = host_config.spi_size - (current_addr & mask);
+        if (chunk > length) {
+            chunk = length;
+        }
+        memcpy(dest, flash + (current_addr & mask), chunk);
+        dest += chunk;
+        current_addr += chunk;
+        length -= chunk;
+    }
+}
+
+static int data_load_spi_init(void) {
+    current_addr = 0;
+    spi_commands = 0;
+    spi_bytes = 0;
+    spi_bus_ns = 0;
+    return flash ? 0 : -1;
+}
+
+static int data_load_spi_load(void *dest, uint32_t length, bool hash) {
+    unsigned char *pdest = (unsigned char *)dest;
+    uint32_t words = length & ~3;
+    uint32_t trailing = length & 3;
+    uint64_t start;
+
+    if (length == 0) {
+        return 0;
+    }
+
+    if ((words >> 2) > SPI_MAX_FRAMES - 1) {
+        return -1;
+    }
+
+    if (words) {
+        start = host_now_ns();
+        spi_copy(pdest, words);
+        spi_read_command(start, words);
+        pdest += words;
+    }
+    if (trailing) {
+        start = host_now_ns();
+        spi_copy(pdest, trailing);
+        spi_read_command(start, trailing);
+    }
+
+    if (hash) {
+        hash_update((unsigned char *)dest, length);
+    }
+    return 0;
+}
+
+static int data_load_spi_read(void *dest, uint32_t addr, uint32_t length) {
+    current_addr = addr;
+    if (0 == length) {
+        return 0;
+    }
+
+    return data_load_spi_load(dest, length, false);
+}
+
+static int data_load_spi_finish(bool valid, bool is_secure_image) {
+    if (host_config.spi_stats) {
+        fprintf(stderr, "SPI: %u commands, %u bytes, %llu us on the bus\n",
+                spi_commands, spi_bytes,
+                (unsigned long long)(spi_bus_ns / 1000));
+    }
+    return 0;
+}
+
+data_load_ops spi_ops = {
+    .init = data_load_spi_init,
+    .read = data_load_spi_read,
+    .load = data_load_spi_load,
+    .finish = data_load_spi_finish
+};
+
+int host_spi_erase(uint32_t addr, uint32_t length) {
+    uint64_t start = host_now_ns();
+    uint32_t blocks;
+
+    if (!flash || (addr | length) & (SPI_ERASE_BLOCK_SIZE - 1) ||
+        addr >= host_config.spi_size ||
+        length > host_config.spi_size - addr) {
+        return -1;
+    }
+
+    memset(flash + addr, SPI_ERASED_BYTE, length);
+
+    blocks = length / SPI_ERASE_BLOCK_SIZE;
+    host_wait_until_ns(start + (uint64_t)blocks * SPI_BLOCK_ERASE_NS);
+    return 0;
+}
+
+int host_spi_program(uint32_t addr, const void *src, uint32_t length) {
+    const uint8_t *psrc = src;
+    uint64_t start = host_now_ns();
+    uint32_t pages = 0;
+    uint32_t chunk;
+    uint32_t i;
+
+    if (!flash || addr >= host_config.spi_size ||
+        length > host_config.spi_size - addr) {
+        return -1;
+    }
+
+    /* One page program command per page touched; bits only go 1 -> 0 */
+    while (length > 0) {
+        chunk = SPI_PAGE_SIZE - (addr & (SPI_PAGE_SIZE - 1));
+        if (chunk > length) {
+            chunk = length;
+        }
+        for (i = 0; i < chunk; i++) {
+            flash[addr + i] &= psrc[i];
+        }
+        addr += chunk;
+        psrc += chunk;
+        length -= chunk;
+        pages++;
+    }
+
+    host_wait_until_ns(start + (uint64_t)pages * SPI_PAGE_PROGRAM_NS);
+    return 0;
+}
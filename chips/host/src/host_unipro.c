@@ -0,0 +1,776 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * UniPro for the host build.
+ *
+ * Each end of the link is a host_unipro_end: its DME attributes and the RX
+ * slots of its CPorts. The boot ROM and the gbboot server, each built for
+ * the host, share the two ends through a file given with --link, mapped by
+ * both processes, so that boot over UniPro runs end to end:
+ *
+ *   build-server/bootrom --spi flash.bin --link /tmp/link &
+ *   build/bootrom --unipro --link /tmp/link
+ *
+ * A peer DME access reads or writes the other end's table directly. Sending
+ * on a CPort copies the message into an RX slot of the CPort at the other
+ * end of the connection, as set up in T_PEERCPORTID by the fake SVC. Like
+ * the two halves of a CPort RX buffer, there are two slots per CPort, and a
+ * sender waits for a free one. The link is up while both processes are
+ * attached.
+ *
+ * Timing: each message occupies the sender's link for its length over
+ * --link-mbps, and becomes visible to the receiver --link-latency ns after
+ * that. Peer DME accesses wait for a round trip. Either process can set
+ * these; the link runs at the lower bandwidth and the longer latency of
+ * the two.
+ *
+ * --link-mbps is the link as it comes up, in its slow mode. Writing
+ * PA_PWRMODE for FAST mode changes the power mode of both ends, as the
+ * PHYs would, if the gears and lanes in the PA_* attributes are within
+ * what the receiving ends allow (PA_MAXRXHSGEAR, --max-hs-gear, and one
+ * connected lane each way); DME_POWERMODEIND reports the outcome. From
+ * then on each end transmits at the payload rate of its HS gear, series
+ * and lanes, whatever --link-mbps says. The link starts out slow again
+ * each time it comes up.
+ *
+ * The mailbox works as the ROM code expects of the switch: writing a
+ * non-zero value to an end's TSB_MAILBOX raises TSB_INTERRUPTSTATUS_MAILBOX
+ * there, and the acknowledgement in MBOX_ACK_ATTR clears it.
+ *
+ * Without --link there is no peer: the link never comes up and peer
+ * accesses fail.
+ *
+ * With --replay, a capture log stands in for the peer instead (see
+ * host_capture.c): the link is up from the start, the mailbox values and
+ * messages in the log arrive in our end as the peer would write them, and
+ * what we send goes to the replay to be checked rather than anywhere.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "host.h"
+#include "chipapi.h"
+#include "chipdef.h"
+#include "common.h"
+#include "bootrom.h"
+#include "debug.h"
+#include "unipro.h"
+#include "tsb_unipro.h"
+
+/* UniPro ConfigResultCode for an access the peer didn't answer */
+#define DME_PEER_COMMUNICATION_FAILURE  8
+
+/* Enough for everything the boot ROM and the fake SVC set */
+#define DME_MAX_ATTRS       128
+
+/* Data lanes each way between the two ends */
+#define HOST_LINK_LANES     1
+
+#define HS_GEAR_MAX         3
+
+#define HOST_CPORT_RX_SLOTS 2
+
+/* The server is the switch end of the link, the boot ROM the module end */
+#ifdef BUILD_FOR_GBBOOT_SERVER
+#define LOCAL_END   1
+#else
+#define LOCAL_END   0
+#endif
+
+struct dme_attr {
+    uint16_t attr;
+    uint16_t selector;
+    uint32_t val;
+};
+
+struct host_rx_slot {
+    uint32_t len;
+    uint64_t deliver_ns;    /* host_now_ns() when it reaches the receiver */
+    uint8_t data[CPORT_RX_BUF_HALF_SIZE];
+};
+
+struct host_cport_rx {
+    uint32_t head;          /* Free-running; written by the sender */
+    uint32_t tail;          /* Free-running; written by the receiver */
+    struct host_rx_slot slots[HOST_CPORT_RX_SLOTS];
+};
+
+struct host_unipro_end {
+    int32_t pid;            /* Process attached to this end, 0 for none */
+    uint32_t mbps;          /* This end's --link-mbps */
+    uint32_t latency_ns;    /* This end's --link-latency */
+    uint32_t hs_mbps;       /* TX rate in FAST mode, 0 in the slow mode */
+    uint32_t dme_lock;
+    uint32_t dme_attr_count;
+    struct dme_attr dme_attrs[DME_MAX_ATTRS];
+    uint64_t tx_idle_ns;    /* When the end's transmitter is next free */
+    struct host_cport_rx rx[HOST_CPORT_MAX];
+};
+
+struct host_unipro_link {
+    struct host_unipro_end end[2];
+};
+
+static struct host_unipro_link *unipro_link;
+static struct host_unipro_end *local_end;
+static struct host_unipro_end *peer_end;
+
+uint32_t boot_status_offline = 0;
+
+/*
+ * Payload Mbit/s of one lane in HS gears 1-3, series A then B: the line
+ * rate less the 8b10b coding
+ */
+static const uint32_t hs_lane_mbps[2][HS_GEAR_MAX] = {
+    { 998, 1997, 3994 },
+    { 1166, 2332, 4664 },
+};
+
+static bool peer_present(void) {
+    int32_t pid = __atomic_load_n(&peer_end->pid, __ATOMIC_SEQ_CST);
+
+    return pid != 0 && kill(pid, 0) == 0;
+}
+
+/**
+ * @brief Get the bandwidth we transmit at in Mbit/s, 0 for unlimited
+ */
+static uint32_t link_mbps(void) {
+    uint32_t local = local_end->mbps;
+    uint32_t peer = peer_end->mbps;
+    uint32_t hs = __atomic_load_n(&local_end->hs_mbps, __ATOMIC_ACQUIRE);
+
+    if (hs) {
+        return hs;
+    }
+    if (local == 0 || (peer != 0 && peer < local)) {
+        return peer;
+    }
+    return local;
+}
+
+static uint32_t link_latency_ns(void) {
+    uint32_t local = local_end->latency_ns;
+    uint32_t peer = peer_end->latency_ns;
+
+    return peer > local ? peer : local;
+}
+
+/**
+ * @brief Wait out the round trip of a peer DME access
+ */
+static void peer_round_trip(void) {
+    host_wait_until_ns(host_now_ns() + 2 * (uint64_t)link_latency_ns());
+}
+
+static void dme_lock(struct host_unipro_end *end) {
+    while (__atomic_test_and_set(&end->dme_lock, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+}
+
+static void dme_unlock(struct host_unipro_end *end) {
+    __atomic_clear(&end->dme_lock, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Find an attribute in an end's table, optionally adding it
+ * @return The attribute, or NULL if it isn't there and can't be added
+ */
+static struct dme_attr *dme_find(struct host_unipro_end *end, uint16_t attr,
+                                 uint16_t selector, bool add) {
+    unsigned int i;
+
+    for (i = 0; i < end->dme_attr_count; i++) {
+        if (end->dme_attrs[i].attr == attr &&
+            end->dme_attrs[i].selector == selector) {
+            return &end->dme_attrs[i];
+        }
+    }
+    if (!add || end->dme_attr_count == DME_MAX_ATTRS) {
+        return NULL;
+    }
+
+    end->dme_attrs[end->dme_attr_count].attr = attr;
+    end->dme_attrs[end->dme_attr_count].selector = selector;
+    end->dme_attrs[end->dme_attr_count].val = 0;
+    return &end->dme_attrs[end->dme_attr_count++];
+}
+
+static uint32_t dme_get(struct host_unipro_end *end, uint16_t attr,
+                        uint16_t selector) {
+    struct dme_attr *a;
+    uint32_t val;
+
+    dme_lock(end);
+    /* Anything never set reads as its reset value, 0 */
+    a = dme_find(end, attr, selector, false);
+    val = a ? a->val : 0;
+    dme_unlock(end);
+    return val;
+}
+
+static int dme_set(struct host_unipro_end *end, uint16_t attr,
+                   uint16_t selector, uint32_t val) {
+    struct dme_attr *a;
+    struct dme_attr *irq;
+    int rc = 0;
+
+    dme_lock(end);
+    a = dme_find(end, attr, selector, true);
+    irq = dme_find(end, TSB_INTERRUPTSTATUS, 0, true);
+    if (!a || !irq) {
+        rc = -ENOMEM;
+    } else {
+        a->val = val;
+        if (attr == TSB_MAILBOX && val != TSB_MAIL_RESET) {
+            irq->val |= TSB_INTERRUPTSTATUS_MAILBOX;
+        } else if (attr == MBOX_ACK_ATTR) {
+            irq->val &= ~TSB_INTERRUPTSTATUS_MAILBOX;
+        }
+    }
+    dme_unlock(end);
+    return rc;
+}
+
+static void host_unipro_detach(void) {
+    __atomic_store_n(&local_end->pid, 0, __ATOMIC_SEQ_CST);
+}
+
+int host_unipro_open(void) {
+    int flags = MAP_SHARED;
+    int fd = -1;
+    void *p;
+
+    if (host_config.replay_file && host_replay_open()) {
+        return -1;
+    }
+
+    if (host_config.link_path) {
+        fd = open(host_config.link_path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0 || ftruncate(fd, sizeof(*unipro_link)) < 0) {
+            perror(host_config.link_path);
+            return -1;
+        }
+    } else {
+        flags |= MAP_ANONYMOUS;
+    }
+
+    p = mmap(NULL, sizeof(*unipro_link), PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mapping the UniPro link");
+        return -1;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    unipro_link = p;
+    local_end = &unipro_link->end[LOCAL_END];
+    peer_end = &unipro_link->end[!LOCAL_END];
+
+    /* Our end starts from reset, whatever a previous run left in it */
+    memset(local_end, 0, sizeof(*local_end));
+    local_end->mbps = host_config.link_mbps;
+    local_end->latency_ns = host_config.link_latency_ns;
+    dme_set(local_end, DME_DDBL1_MANUFACTURERID, 0, host_config.unipro_mid);
+    dme_set(local_end, DME_DDBL1_PRODUCTID, 0, host_config.unipro_pid);
+    dme_set(local_end, TSB_POWERSTATE, 0, POWERSTATE_LINKDOWN);
+    dme_set(local_end, PA_MAXRXHSGEAR, 0, host_config.max_hs_gear);
+    dme_set(local_end, PA_CONNECTEDTXDATALANES, 0, HOST_LINK_LANES);
+    dme_set(local_end, PA_CONNECTEDRXDATALANES, 0, HOST_LINK_LANES);
+    dme_set(local_end, PA_PWRMODE, 0,
+            PA_PWRMODE_RX(PA_SLOW_MODE) | PA_PWRMODE_TX(PA_SLOW_MODE));
+    if (host_config.replay_file) {
+        dme_set(local_end, TSB_POWERSTATE, 0, POWERSTATE_LINKUP);
+        return 0;
+    }
+    if (!host_config.link_path) {
+        return 0;
+    }
+
+    /*
+     * Whichever end attaches second brings the link up for both. Both
+     * store their pid before looking for the other's, so at least one
+     * sees the other.
+     */
+    __atomic_store_n(&local_end->pid, getpid(), __ATOMIC_SEQ_CST);
+    atexit(host_unipro_detach);
+    if (peer_present()) {
+        /* The peer may have been in FAST mode with whoever was here before */
+        __atomic_store_n(&peer_end->hs_mbps, 0, __ATOMIC_RELEASE);
+        dme_set(peer_end, PA_PWRMODE, 0,
+                PA_PWRMODE_RX(PA_SLOW_MODE) | PA_PWRMODE_TX(PA_SLOW_MODE));
+        dme_set(peer_end, DME_POWERMODEIND, 0, DME_POWERMODEIND_NONE);
+        dme_set(peer_end, TSB_POWERSTATE, 0, POWERSTATE_LINKUP);
+        dme_set(local_end, TSB_POWERSTATE, 0, POWERSTATE_LINKUP);
+    }
+    return 0;
+}
+
+/**
+ * @brief Play whatever the replayed peer has due into our end
+ * @return Number of items delivered
+ */
+static int replay_poll(void) {
+    struct host_replay_rx rx;
+    struct host_cport_rx *cport_rx;
+    struct host_rx_slot *slot;
+    int delivered = 0;
+
+    while (host_replay_next(&rx)) {
+        if (rx.type == CAPTURE_MAILBOX_RX) {
+            /* Like the switch, wait for the last mail to be acknowledged */
+            if (dme_get(local_end, TSB_INTERRUPTSTATUS, 0) &
+                TSB_INTERRUPTSTATUS_MAILBOX) {
+                break;
+            }
+            dme_set(local_end, TSB_MAILBOX, 0, rx.arg);
+        } else {
+            cport_rx = &local_end->rx[rx.arg];
+            if (cport_rx->head - cport_rx->tail >= HOST_CPORT_RX_SLOTS) {
+                break;
+            }
+            slot = &cport_rx->slots[cport_rx->head % HOST_CPORT_RX_SLOTS];
+            memcpy(slot->data, rx.data, rx.length);
+            slot->len = rx.length;
+            slot->deliver_ns = 0;
+            cport_rx->head++;
+        }
+        host_replay_delivered();
+        delivered++;
+    }
+    return delivered;
+}
+
+int chip_unipro_attr_read(uint16_t attr,
+                          uint32_t *val,
+                          uint16_t selector,
+                          int peer) {
+    if (peer && host_config.replay_file) {
+        /* The replayed switch has always taken our mail */
+        *val = 0;
+        return 0;
+    }
+    if (peer) {
+        if (!peer_present()) {
+            return DME_PEER_COMMUNICATION_FAILURE;
+        }
+        peer_round_trip();
+        *val = dme_get(peer_end, attr, selector);
+        return 0;
+    }
+
+    *val = dme_get(local_end, attr, selector);
+    return 0;
+}
+
+/**
+ * @brief Check that one direction of the link can run in a HS mode
+ * @return Its payload rate in Mbit/s, 0 if the receiver can't take it
+ */
+static uint32_t hs_mode_mbps(uint32_t gear, uint32_t series, uint32_t lanes,
+                             struct host_unipro_end *rx_end) {
+    if (gear < 1 || gear > HS_GEAR_MAX ||
+        gear > dme_get(rx_end, PA_MAXRXHSGEAR, 0) ||
+        (series != PA_HS_SERIES_A && series != PA_HS_SERIES_B) ||
+        lanes < 1 || lanes > HOST_LINK_LANES) {
+        return 0;
+    }
+    return hs_lane_mbps[series - PA_HS_SERIES_A][gear - 1] * lanes;
+}
+
+/**
+ * @brief Change the power mode of both ends, as set up in our PA_* attributes
+ *
+ * Only FAST mode in both directions is modelled; anything else, like a gear
+ * the receiver can't take, is turned down with DME_POWERMODEIND_CAP_ERR and
+ * the link stays as it was.
+ * @return 0 once DME_POWERMODEIND has the outcome, >0 for UniPro error
+ */
+static int power_mode_change(uint32_t mode) {
+    uint32_t tx_gear = dme_get(local_end, PA_TXGEAR, 0);
+    uint32_t rx_gear = dme_get(local_end, PA_RXGEAR, 0);
+    uint32_t series = dme_get(local_end, PA_HSSERIES, 0);
+    uint32_t tx_lanes = dme_get(local_end, PA_ACTIVETXDATALANES, 0);
+    uint32_t rx_lanes = dme_get(local_end, PA_ACTIVERXDATALANES, 0);
+    uint32_t tx_mbps = 0;
+    uint32_t rx_mbps = 0;
+
+    if (host_config.replay_file || !peer_present()) {
+        return DME_PEER_COMMUNICATION_FAILURE;
+    }
+
+    dme_set(local_end, DME_POWERMODEIND, 0, DME_POWERMODEIND_NONE);
+    /* The PACP request and its confirmation */
+    peer_round_trip();
+
+    if (mode == (PA_PWRMODE_RX(PA_FAST_MODE) | PA_PWRMODE_TX(PA_FAST_MODE))) {
+        tx_mbps = hs_mode_mbps(tx_gear, series, tx_lanes, peer_end);
+        rx_mbps = hs_mode_mbps(rx_gear, series, rx_lanes, local_end);
+    }
+    if (!tx_mbps || !rx_mbps) {
+        return dme_set(local_end, DME_POWERMODEIND, 0,
+                       DME_POWERMODEIND_CAP_ERR);
+    }
+
+    /* The peer's PA_* attributes follow, seen from its side */
+    dme_set(peer_end, PA_TXGEAR, 0, rx_gear);
+    dme_set(peer_end, PA_RXGEAR, 0, tx_gear);
+    dme_set(peer_end, PA_HSSERIES, 0, series);
+    dme_set(peer_end, PA_ACTIVETXDATALANES, 0, rx_lanes);
+    dme_set(peer_end, PA_ACTIVERXDATALANES, 0, tx_lanes);
+    dme_set(peer_end, PA_PWRMODE, 0, mode);
+    dme_set(local_end, PA_PWRMODE, 0, mode);
+    __atomic_store_n(&peer_end->hs_mbps, rx_mbps, __ATOMIC_RELEASE);
+    __atomic_store_n(&local_end->hs_mbps, tx_mbps, __ATOMIC_RELEASE);
+    dme_set(peer_end, DME_POWERMODEIND, 0, DME_POWERMODEIND_REMOTE);
+    return dme_set(local_end, DME_POWERMODEIND, 0, DME_POWERMODEIND_OK);
+}
+
+int chip_unipro_attr_write(uint16_t attr,
+                           uint32_t val,
+                           uint16_t selector,
+                           int peer) {
+    if (peer && host_config.replay_file) {
+        if (attr == TSB_MAILBOX) {
+            host_replay_tx(CAPTURE_MAILBOX_TX, val, NULL, 0);
+        }
+        return 0;
+    }
+    if (peer) {
+        if (!peer_present()) {
+            return DME_PEER_COMMUNICATION_FAILURE;
+        }
+        peer_round_trip();
+        return dme_set(peer_end, attr, selector, val);
+    }
+
+    if (attr == PA_PWRMODE) {
+        return power_mode_change(val);
+    }
+    return dme_set(local_end, attr, selector, val);
+}
+
+int chip_unipro_attr_access_batch(struct unipro_attr_req *reqs,
+                                  unsigned int count) {
+    unsigned int i;
+    int rc;
+
+    for (i = 0; i < count; i++) {
+        if (reqs[i].write) {
+            rc = chip_unipro_attr_write(reqs[i].attr, reqs[i].val,
+                                        reqs[i].selector, reqs[i].peer);
+        } else {
+            rc = chip_unipro_attr_read(reqs[i].attr, &reqs[i].val,
+                                       reqs[i].selector, reqs[i].peer);
+        }
+        if (rc) {
+            return rc;
+        }
+    }
+    return 0;
+}
+
+int chip_unipro_attr_wait(uint16_t attr,
+                          uint16_t selector,
+                          int peer,
+                          uint32_t mask,
+                          uint32_t value,
+                          int cond,
+                          uint32_t *result) {
+    uint32_t val;
+    int rc;
+
+    while (1) {
+        rc = chip_unipro_attr_read(attr, &val, selector, peer);
+        if (rc) {
+            return rc;
+        }
+        if ((cond == UNIPRO_WAIT_EQ) == ((val & mask) == value)) {
+            if (result) {
+                *result = val;
+            }
+            return 0;
+        }
+
+        if (host_config.replay_file) {
+            if (replay_poll() == 0 && host_replay_finished()) {
+                dbgprintx32("Replay ended in a DME wait on ", attr, "\n");
+                host_exit(1);
+            }
+        } else if (!host_config.link_path) {
+            /* Nothing else can change an attribute, so this never ends */
+            dbgprintx32("DME wait never finishes on ", attr, "\n");
+            host_exit(1);
+        }
+        dbgpoll();
+        sched_yield();
+    }
+}
+
+void chip_unipro_init(void) {
+    dbgprint("Unipro enabled!\n");
+}
+
+/**
+ * @brief Move to --hs-gear, if given, once the link is up
+ *
+ * A replayed session has no PHY at the other end to change mode with.
+ */
+int chip_unipro_change_power_mode(void) {
+    if (host_config.hs_gear == 0 || host_config.replay_file) {
+        return 0;
+    }
+    return unipro_change_power_mode(host_config.hs_gear,
+                                    host_config.hs_series);
+}
+
+void chip_wait_for_link_up(void) {
+    if (!host_config.link_path && !host_config.replay_file) {
+        dbgprint("No UniPro link on the host\n");
+        host_exit(1);
+    }
+    chip_unipro_attr_wait(TSB_POWERSTATE, 0, ATTR_LOCAL,
+                          0xFFFFFFFF, POWERSTATE_LINKUP, UNIPRO_WAIT_EQ,
+                          NULL);
+}
+
+void chip_reset_before_ready(void) {
+}
+
+/**
+ * @brief Open a CPort once the switch has announced it in the mailbox
+ */
+int chip_unipro_init_cport(uint32_t cportid) {
+    uint32_t mail = 0;
+    int rc;
+
+    if (cportid >= HOST_CPORT_MAX) {
+        return -EINVAL;
+    }
+
+    rc = read_mailbox(&mail);
+    if (rc) {
+        return rc;
+    }
+    if (mail != cportid + 1) {
+        return -ENOSYS;
+    }
+
+    return ack_mailbox((uint16_t)mail);
+}
+
+/**
+ * @brief Open whichever CPort the switch announces in the mailbox
+ */
+int chip_unipro_recv_cport(uint32_t *cportid) {
+    uint32_t mail = 0;
+    int rc;
+
+    rc = read_mailbox(&mail);
+    if (rc) {
+        return rc;
+    }
+    *cportid = --mail;
+
+    if (mail >= HOST_CPORT_MAX) {
+        return -EINVAL;
+    }
+
+    return ack_mailbox((uint16_t)(mail + 1));
+}
+
+int chip_unipro_send(unsigned int cportid, const void *buf, size_t len) {
+    struct host_cport_rx *rx;
+    struct host_rx_slot *slot;
+    uint32_t peer_cportid;
+    uint32_t head;
+    uint64_t start;
+    uint32_t mbps = link_mbps();
+
+    if (cportid >= HOST_CPORT_MAX || len > CPORT_RX_BUF_HALF_SIZE) {
+        return -1;
+    }
+
+    if (host_config.replay_file) {
+        host_replay_tx(CAPTURE_CPORT_TX, cportid, buf, len);
+        return 0;
+    }
+
+    if (dme_get(local_end, T_CONNECTIONSTATE, cportid) != 1) {
+        return -1;
+    }
+    peer_cportid = dme_get(local_end, T_PEERCPORTID, cportid);
+    if (peer_cportid >= HOST_CPORT_MAX) {
+        return -1;
+    }
+    rx = &peer_end->rx[peer_cportid];
+
+    /* Wait for the receiver to free a slot */
+    head = rx->head;
+    while (head - __atomic_load_n(&rx->tail, __ATOMIC_ACQUIRE) >=
+           HOST_CPORT_RX_SLOTS) {
+        if (!peer_present()) {
+            return -1;
+        }
+        sched_yield();
+    }
+
+    /* The TX buffer can't take this message until the last one has gone */
+    start = host_now_ns();
+    if (start < local_end->tx_idle_ns) {
+        host_wait_until_ns(local_end->tx_idle_ns);
+        start = local_end->tx_idle_ns;
+    }
+    if (mbps) {
+        local_end->tx_idle_ns = start + (uint64_t)len * 8000 / mbps;
+    } else {
+        local_end->tx_idle_ns = start;
+    }
+
+    slot = &rx->slots[head % HOST_CPORT_RX_SLOTS];
+    memcpy(slot->data, buf, len);
+    slot->len = len;
+    slot->deliver_ns = local_end->tx_idle_ns + link_latency_ns();
+    __atomic_store_n(&rx->head, head + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int chip_unipro_receive(unsigned int cportid, unipro_rx_handler handler) {
+    struct unipro_rx_dispatch rx = {cportid, handler};
+
+    return chip_unipro_receive_any(&rx, 1) < 0 ? -1 : 0;
+}
+
+int chip_unipro_receive_any(const struct unipro_rx_dispatch *rx,
+                            unsigned int count) {
+    struct host_cport_rx *cport_rx;
+    struct host_rx_slot *slot;
+    unsigned int i;
+    uint32_t tail;
+    int handled = 0;
+
+    /* With nothing to listen on, the wait below would never end */
+    if (rx == NULL || count == 0) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (rx[i].cportid >= HOST_CPORT_MAX) {
+            return -1;
+        }
+    }
+
+    while (handled == 0) {
+        for (i = 0; i < count; i++) {
+            cport_rx = &local_end->rx[rx[i].cportid];
+            tail = cport_rx->tail;
+            if (__atomic_load_n(&cport_rx->head, __ATOMIC_ACQUIRE) == tail) {
+                continue;
+            }
+            slot = &cport_rx->slots[tail % HOST_CPORT_RX_SLOTS];
+            if (host_now_ns() < slot->deliver_ns) {
+                continue;
+            }
+
+            handled++;
+            if (rx[i].handler != NULL &&
+                rx[i].handler(rx[i].cportid, slot->data, slot->len) != 0) {
+                dbgprint("RX handler returned error\n");
+                return -1;
+            }
+            /* Only now can the sender reuse the slot */
+            __atomic_store_n(&cport_rx->tail, tail + 1, __ATOMIC_RELEASE);
+        }
+
+        if (handled == 0) {
+            if (host_config.replay_file) {
+                if (replay_poll() == 0 && host_replay_finished()) {
+                    dbgprint("Replay ended waiting for a message\n");
+                    return -1;
+                }
+            } else if (!host_config.link_path) {
+                return -1;
+            }
+            sched_yield();
+        }
+    }
+
+    return handled;
+}
+
+/**
+ * @brief Advertise the boot status, ending the run if the boot has failed
+ *
+ * On the chip halt_and_catch_fire() advertises the failure and spins; here
+ * the process exits instead, once the status is in place.
+ */
+void chip_advertise_boot_status(uint32_t boot_status) {
+    if (chip_unipro_attr_write(DME_DDBL2_INIT_STATUS, boot_status, 0,
+                               ATTR_LOCAL) != 0) {
+        boot_status_offline = true;
+        halt_and_catch_fire(boot_status);
+    }
+
+    if (boot_status & INIT_STATUS_FAILED) {
+        host_exit(1);
+    }
+}
+
+int chip_advertise_boot_metrics(const uint32_t *metrics, unsigned int count) {
+    struct unipro_attr_req reqs[BOOT_METRICS_MAX_WORDS];
+    unsigned int i;
+
+    if (count > BOOT_METRICS_MAX_WORDS) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < count; i++) {
+        reqs[i].attr = BOOT_METRICS_ATTR + i;
+        reqs[i].selector = 0;
+        reqs[i].val = metrics[i];
+        reqs[i].peer = ATTR_LOCAL;
+        reqs[i].write = 1;
+    }
+
+    return chip_unipro_attr_access_batch(reqs, count);
+}
+
+int chip_advertise_boot_type(void) {
+    return chip_unipro_attr_write(DME_DDBL2_INIT_TYPE, INIT_TYPE_TOSHIBA, 0,
+                                  ATTR_LOCAL);
+}
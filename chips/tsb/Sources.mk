@@ -38,6 +38,9 @@ CHIPDEFINES += -DCONFIG_GPIO
 CHIP_CSRC +=  $(CHIP_SRCDIR)/tsb_gpio.c
 endif
 CHIP_CSRC += $(CHIP_SRCDIR)/tsb_isaa.c
+ifeq ($(_PROFILE),1)
+CHIP_CSRC += $(CHIP_SRCDIR)/tsb_profile.c
+endif
 CHIP_CSRC += $(CHIP_SRCDIR)/tsb_unipro.c
 
 CHIP_ASRC = $(CHIP_SRCDIR)/boot.S
@@ -38,4 +38,12 @@
 
 #include "chipdef.h"
 
+/**
+ * @brief Change the SysTick reload value without upsetting
+ *        chip_cycle_count(), which may be counting with SysTick
+ *
+ * @param reload The new SYST_RVR value
+ */
+void tsb_systick_set_reload(uint32_t reload);
+
 #endif /* __ARCH_ARM_TSB_CHIP_H */
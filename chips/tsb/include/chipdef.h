@@ -100,6 +100,38 @@
 #define CM3UP_BASE      0xE000E000
 #define CM3UP_SIZE      0x1000
 
+/* External interrupt numbers (exception number - 16) */
+#define TSB_IRQ_UNIPRO  53  /* UNIPRO_INT_BEF and LUP_INT_BEF */
+
+/* Cortex-M3 NVIC and system control registers */
+#define NVIC_ICPR0      (CM3UP_BASE + 0x280)
+#define NVIC_ICPR1      (CM3UP_BASE + 0x284)
+    #define NVIC_ICPR(irq)      (NVIC_ICPR0 + (((irq) >> 5) << 2))
+    #define NVIC_IRQ_BIT(irq)   (1 << ((irq) & 31))
+#define SCB_ICSR        (CM3UP_BASE + 0xD04)
+    #define SCB_ICSR_PENDSTCLR  (1 << 25)
+    #define SCB_ICSR_PENDSTSET  (1 << 26)
+#define SCB_VTOR        (CM3UP_BASE + 0xD08)
+#define SCB_SCR         (CM3UP_BASE + 0xD10)
+    #define SCB_SCR_SEVONPEND   (1 << 4)
+#define DEMCR           (CM3UP_BASE + 0xDFC)
+    #define DEMCR_TRCENA        (1 << 24)
+
+/* Cortex-M3 SysTick timer */
+#define SYST_CSR        (CM3UP_BASE + 0x010)
+    #define SYST_CSR_ENABLE     (1 << 0)
+    #define SYST_CSR_TICKINT    (1 << 1)
+    #define SYST_CSR_CLKSOURCE  (1 << 2)
+#define SYST_RVR        (CM3UP_BASE + 0x014)
+#define SYST_CVR        (CM3UP_BASE + 0x018)
+    #define SYST_MAX            0x00FFFFFF
+
+/* Cortex-M3 DWT cycle counter */
+#define DWT_CTRL        0xE0001000
+    #define DWT_CTRL_CYCCNTENA  (1 << 0)
+    #define DWT_CTRL_NOCYCCNT   (1 << 25)
+#define DWT_CYCCNT      0xE0001004
+
 #define ISAA_BASE       0x40084000
 #define ISAA_SIZE       0x1000
 
@@ -30,6 +30,7 @@
 #define __ARCH_ARM_SRC_TSB_TSB_UNIPRO_H
 
 #include "chip.h"
+#include "chipapi.h"
 #include "unipro.h"
 
 #define CPORT_STATUS_0                         0x00000000
@@ -136,6 +137,11 @@
 #define A2D_ATTRACS_DATA_CTRL_15               0x0000058C
 #define A2D_ATTRACS_STS_00                     0x00000590
 #define A2D_ATTRACS_STS_01                     0x00000594
+    /* One 4-bit UniPro result code per slot, 8 slots per register */
+    #define REG_ATTRACS_STS(slot)              (A2D_ATTRACS_STS_00 + \
+                                                (((slot) >> 3) << 2))
+    #define REG_ATTRACS_STS_SHIFT(slot)        (((slot) & 7) << 2)
+    #define REG_ATTRACS_STS_MASK               (0xF)
 #define A2D_ATTRACS_DATA_STS_00                0x000005A0
 #define A2D_ATTRACS_DATA_STS_01                0x000005A4
 #define A2D_ATTRACS_DATA_STS_02                0x000005A8
@@ -152,6 +158,7 @@
 #define A2D_ATTRACS_DATA_STS_13                0x000005D4
 #define A2D_ATTRACS_DATA_STS_14                0x000005D8
 #define A2D_ATTRACS_DATA_STS_15                0x000005DC
+#define A2D_ATTRACS_MAX_SLOTS                  16
 #define CPA_DEEPSTALL_CTRL                     0x00000600
 #define CPA_ARBITER_CTRL                       0x00000604
 #define CPA_WRIF_TC_CTRL_0                     0x00000608
@@ -590,6 +597,8 @@
 #define CPORT_RX_BUF_SIZE         (CPORT_BUF_SIZE)
 #define CPORT_RX_BUF(cport)       (void*)(CPORT_RX_BUF_BASE + \
                                       (CPORT_RX_BUF_SIZE * cport))
+/* Each RX region is used as two halves, one filling while the other is read */
+#define CPORT_RX_BUF_HALF_SIZE    (CPORT_RX_BUF_SIZE / 2)
 #define CPORT_TX_BUF_BASE         (0x50000000U)
 #define CPORT_TX_BUF_SIZE         (0x20000U)
 #define CPORT_TX_BUF(cport)       (uint8_t*)(CPORT_TX_BUF_BASE + \
@@ -610,6 +619,7 @@ struct cport {
     uint8_t *tx_buf;                /* TX region for this CPort */
     uint8_t *rx_buf;                /* RX region for this CPort */
     uint16_t cportid;
+    uint8_t rx_half;                /* Half of rx_buf armed for RX */
 };
 
 extern struct cport cporttable[4];
@@ -625,6 +635,11 @@ static inline struct cport *cport_handle(uint16_t cportid) {
 
 int tsb_reset_all_cports(void);
 
+/**
+ * @brief Reset only the CPorts that have been armed since their last reset
+ */
+int tsb_reset_cports_in_use(void);
+
 int tsb_unipro_init_cport(uint32_t cportid);
 int tsb_unipro_recv_cport(uint32_t *cportid);
 
@@ -632,6 +647,24 @@ uint32_t tsb_unipro_read(uint32_t offset);
 void tsb_unipro_write(uint32_t offset, uint32_t v);
 void tsb_unipro_restart_rx(struct cport *cport);
 
+/**
+ * @brief Dispatch the messages waiting on a set of CPorts
+ *
+ * Reads the RX EOM/EOT status once per pass for all of the CPorts, rather
+ * than once per CPort.
+ */
+int tsb_unipro_receive_any(const struct unipro_rx_dispatch *rx,
+                           unsigned int count);
+
+/**
+ * @brief Run a list of DME accesses through the ATTRACS slots
+ *
+ * Up to A2D_ATTRACS_MAX_SLOTS requests are loaded into the slot registers
+ * and started with a single MSTR_CTRL write; longer lists are split.
+ */
+int tsb_unipro_attr_access_batch(struct unipro_attr_req *reqs,
+                                 unsigned int count);
+
 /**
  * @brief Disable E2EFC on all CPorts
  */
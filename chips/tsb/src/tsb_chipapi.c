@@ -26,9 +26,11 @@
  * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdbool.h>
 #include "chip.h"
 #include "chipapi.h"
 #include "debug.h"
+#include "timeline.h"
 #include "tsb_scm.h"
 
 #if defined(_SIMULATION) && ((BOOT_STAGE == 1) || (BOOT_STAGE == 3))
@@ -40,6 +42,38 @@
 #define GPIO_TEST_STATUS_FAIL 1
 #define HANDSHAKE_GPIO_CLR_BITS (1 << 4)
 #define HANDSHAKE_GPIO_SET_BITS (1 << 10) | (1 << 11)
+
+/*
+ * Boot phase markers for the simulation waveform: the phase on GPIO 19-22,
+ * 1 on GPIO 24 for its beginning or 0 for its end, then GPIO 25 toggles.
+ * tools/simphases turns a VCD of these pins into a per-phase report.
+ *
+ * GPIO 16-18 are the handshake above, GPIO 3, 4, 5 and 23 wake the chip from
+ * standby (TEST_WAKEUPSRC in es3_workram_standby.c), and the pins below 16
+ * share their pads with the functions selected in PINSHARE. Nothing drives
+ * GPIO 19-22, 24 or 25.
+ */
+#define GPIO_MARKER_PHASE 19
+#define GPIO_MARKER_PHASE_BITS 4
+#define GPIO_MARKER_BEGIN 24
+#define GPIO_MARKER_STROBE 25
+
+typedef char ___marker_test[(NUMBER_OF_BOOT_PHASES <=
+                             (1 << GPIO_MARKER_PHASE_BITS)) ? 1 : -1];
+
+static bool markers_ready;
+static uint8_t marker_strobe;
+
+static void phase_marker_init(void) {
+    int i;
+
+    for (i = 0; i < GPIO_MARKER_PHASE_BITS; i++) {
+        chip_gpio_direction_out(GPIO_MARKER_PHASE + i, 0);
+    }
+    chip_gpio_direction_out(GPIO_MARKER_BEGIN, 0);
+    chip_gpio_direction_out(GPIO_MARKER_STROBE, marker_strobe);
+    markers_ready = true;
+}
 #endif
 
 void chip_init(void) {
@@ -64,6 +98,7 @@ void chip_init(void) {
     chip_gpio_direction_in(GPIO_RESP);
     chip_gpio_direction_out(GPIO_REQ, 0);
     chip_gpio_direction_out(GPIO_TEST_STATUS, GPIO_TEST_STATUS_OK);
+    phase_marker_init();
 #endif
 }
 
@@ -116,4 +151,107 @@ void chip_handshake_boot_status(uint32_t status) {
             GPIO_TEST_STATUS_FAIL : GPIO_TEST_STATUS_OK);
     chip_handshake_with_test_controller();
 }
+
+/**
+ * @brief Show a boot phase boundary on the marker GPIOs
+ *
+ * Markers before chip_init() has set up the GPIOs are dropped.
+ *
+ * @param phase The boot phase (BOOT_PHASE_xxx)
+ * @param type TIMELINE_EVENT_BEGIN or TIMELINE_EVENT_END
+ *
+ * @returns Nothing.
+ */
+void chip_phase_marker(uint8_t phase, uint8_t type) {
+    int i;
+
+    if (!markers_ready) {
+        return;
+    }
+
+    for (i = 0; i < GPIO_MARKER_PHASE_BITS; i++) {
+        chip_gpio_set_value(GPIO_MARKER_PHASE + i, (phase >> i) & 1);
+    }
+    chip_gpio_set_value(GPIO_MARKER_BEGIN, type == TIMELINE_EVENT_BEGIN);
+    /* Last, so the other pins are settled when the strobe changes */
+    marker_strobe = !marker_strobe;
+    chip_gpio_set_value(GPIO_MARKER_STROBE, marker_strobe);
+}
 #endif
+
+/*
+ * The DWT cycle counter is optional on Cortex-M3. Without it, fall back to
+ * SysTick on the core clock: a 24-bit down-counter, extended in software, so
+ * it must be read at least once per SysTick period to stay monotonic.
+ *
+ * The profiler's SysTick handler reads the counter too, so the software part
+ * is only updated with interrupts masked.
+ */
+static bool use_systick;
+static uint32_t systick_last;
+static uint32_t systick_high;
+
+static inline uint32_t systick_lock(void) {
+    uint32_t primask;
+
+    __asm__ volatile ("mrs %0, primask\n"
+                      "cpsid i" : "=r" (primask) :: "memory");
+    return primask;
+}
+
+static inline void systick_unlock(uint32_t primask) {
+    __asm__ volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+void chip_cycle_counter_init(void) {
+    putreg32(getreg32(DEMCR) | DEMCR_TRCENA, DEMCR);
+    use_systick = (getreg32(DWT_CTRL) & DWT_CTRL_NOCYCCNT) != 0;
+    if (!use_systick) {
+        putreg32(0, DWT_CYCCNT);
+        putreg32(getreg32(DWT_CTRL) | DWT_CTRL_CYCCNTENA, DWT_CTRL);
+        return;
+    }
+
+    putreg32(SYST_MAX, SYST_RVR);
+    putreg32(0, SYST_CVR);
+    putreg32(SYST_CSR_CLKSOURCE | SYST_CSR_ENABLE, SYST_CSR);
+    systick_last = 0;
+    systick_high = 0;
+}
+
+uint32_t chip_cycle_count(void) {
+    uint32_t primask;
+    uint32_t reload;
+    uint32_t elapsed;
+    uint32_t count;
+
+    if (!use_systick) {
+        return getreg32(DWT_CYCCNT);
+    }
+
+    primask = systick_lock();
+    /* SysTick counts down from its reload value */
+    reload = getreg32(SYST_RVR);
+    elapsed = reload - getreg32(SYST_CVR);
+    if (elapsed < systick_last) {
+        systick_high += reload + 1;
+    }
+    systick_last = elapsed;
+    count = systick_high + elapsed;
+    systick_unlock(primask);
+    return count;
+}
+
+void tsb_systick_set_reload(uint32_t reload) {
+    uint32_t primask = systick_lock();
+    uint32_t now = chip_cycle_count();
+
+    putreg32(reload, SYST_RVR);
+    putreg32(0, SYST_CVR);
+    if (use_systick) {
+        /* Carry on counting from now in the new period */
+        systick_high = now;
+        systick_last = 0;
+    }
+    systick_unlock(primask);
+}
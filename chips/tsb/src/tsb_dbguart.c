@@ -47,6 +47,20 @@
 #define UART_LSR_THRE (0x1 << 5)
 #define UART_LSR_TX_EMPTY (0x1 << 6)
 
+#define UART_TX_FIFO_DEPTH 16
+
+/*
+ * Output is queued here and moved to the TX FIFO a FIFO-full at a time by
+ * chip_dbgpoll(), so printing does not wait on the UART. Must be a power
+ * of 2.
+ */
+#define DBG_TX_RING_SIZE 512
+
+static uint8_t tx_ring[DBG_TX_RING_SIZE];
+/* Free-running counts, so tx_head - tx_tail is the number of bytes queued */
+static uint32_t tx_head;
+static uint32_t tx_tail;
+
 /**
  * @brief Initialize the debug serial port
  *
@@ -69,6 +83,10 @@ void chip_dbginit(void) {
     tsb_reset(TSB_RST_UARTP);
     tsb_reset(TSB_RST_UARTS);
 
+    /* Anything queued before a reset of the UART is lost with it */
+    tx_head = 0;
+    tx_tail = 0;
+
     /*
      * The controller requires "several cycles" after reset to stabilize before
      * register writes will work. Try this a few times.
@@ -94,6 +112,46 @@ void chip_dbginit(void) {
     }
 }
 
+/**
+ * @brief Move queued output to the UART if its TX FIFO is empty
+ *
+ * With the FIFOs enabled, THRE means the whole TX FIFO is empty, so up to a
+ * FIFO's worth of bytes can be written without polling in between.
+ *
+ * @param None
+ *
+ * @returns Nothing
+ */
+void chip_dbgpoll(void) {
+    unsigned int i;
+
+    if (tx_tail == tx_head ||
+        (getreg32(UART_LSR) & UART_LSR_THRE) != UART_LSR_THRE) {
+        return;
+    }
+
+    for (i = 0; i < UART_TX_FIFO_DEPTH && tx_tail != tx_head; i++) {
+        putreg32(tx_ring[tx_tail & (DBG_TX_RING_SIZE - 1)], UART_RBR_THR_DLL);
+        tx_tail++;
+    }
+}
+
+/**
+ * @brief Queue a byte, waiting for room only if the ring is full
+ *
+ * @param c The byte to queue
+ *
+ * @returns Nothing
+ */
+static void dbg_enqueue(uint8_t c) {
+    while (tx_head - tx_tail == DBG_TX_RING_SIZE) {
+        chip_dbgpoll();
+    }
+
+    tx_ring[tx_head & (DBG_TX_RING_SIZE - 1)] = c;
+    tx_head++;
+}
+
 /**
  * @brief Print a character out the debug serial port
  *
@@ -102,15 +160,39 @@ void chip_dbginit(void) {
  * @returns Nothing
  */
 void chip_dbgputc(int c) {
-    while ((getreg32(UART_LSR) & UART_LSR_THRE) != UART_LSR_THRE)
-        ;
-
     /* Auto-convert "\n" into "\r\n" */
     if (c == '\n') {
-        putreg32('\r', UART_RBR_THR_DLL);
-        while ((getreg32(UART_LSR) & UART_LSR_THRE) != UART_LSR_THRE);
+        dbg_enqueue('\r');
+    }
+    dbg_enqueue(c);
+    chip_dbgpoll();
+}
+
+/**
+ * @brief Queue raw bytes for the debug serial port without waiting
+ *
+ * The bytes are queued all together or not at all, so that nothing else
+ * printed can land in the middle of them.
+ *
+ * @param buf The bytes to send (sent as is, no "\n" conversion)
+ * @param len The number of bytes in buf, at most DBG_TX_RING_SIZE
+ *
+ * @returns len if the bytes were queued, 0 if there was no room for them
+ */
+unsigned int chip_dbgtrywrite(const uint8_t *buf, unsigned int len) {
+    unsigned int i;
+
+    if (DBG_TX_RING_SIZE - (tx_head - tx_tail) < len) {
+        chip_dbgpoll();
+        return 0;
     }
-    putreg32(c, UART_RBR_THR_DLL);
+
+    for (i = 0; i < len; i++) {
+        tx_ring[tx_head & (DBG_TX_RING_SIZE - 1)] = buf[i];
+        tx_head++;
+    }
+    chip_dbgpoll();
+    return len;
 }
 
 /**
@@ -121,6 +203,9 @@ void chip_dbgputc(int c) {
  * @returns Nothing
  */
 void chip_dbgflush(void) {
+    while (tx_tail != tx_head) {
+        chip_dbgpoll();
+    }
     while ((getreg32(UART_LSR) & UART_LSR_TX_EMPTY) != UART_LSR_TX_EMPTY)
         ;
 }
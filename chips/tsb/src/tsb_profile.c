@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Statistical PC-sampling profiler, built with _PROFILE=1
+ *
+ * SysTick interrupts every PROFILE_PERIOD cycles; the handler takes the PC
+ * the hardware stacked on exception entry and counts it in a histogram of
+ * this image's .text. chip_profile_report() prints the histogram on the
+ * debug UART, and tools/profmap maps it back to symbols using the ELF.
+ *
+ * The boot ROM otherwise runs without interrupts, so the handler is installed
+ * in a RAM copy of the vector table and the original table is restored by
+ * chip_profile_stop().
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "chip.h"
+#include "chipapi.h"
+#include "debug.h"
+
+#ifdef _PROFILE
+
+/* Odd, so the samples do not lock step with polling loops */
+#define PROFILE_PERIOD          9973
+
+#define PROFILE_BUCKETS         1024
+#define PROFILE_MIN_SHIFT       2   /* Thumb instructions are 2 or 4 bytes */
+
+/* Exceptions 0-15; SysTick is the last one. No external interrupts used */
+#define VECTOR_COUNT            16
+#define VECTOR_SYSTICK          15
+
+/* The stacked exception frame: r0-r3, r12, lr, pc, xPSR */
+#define FRAME_PC                6
+
+extern char _stext, _etext;
+
+/* The VTOR needs the table aligned to a power of 2 of at least 128 bytes */
+static uint32_t vectors[VECTOR_COUNT] __attribute__ ((aligned(128)));
+static uint32_t saved_vtor;
+static uint32_t saved_syst_csr;
+static uint32_t saved_syst_rvr;
+
+static uint16_t histogram[PROFILE_BUCKETS];
+static uint32_t bucket_shift;
+static uint32_t samples;
+static uint32_t outside;    /* Samples outside .text, or lost to overflow */
+
+/**
+ * @brief Count one sample
+ *
+ * @param frame The exception frame stacked for the SysTick interrupt
+ *
+ * @returns Nothing
+ */
+static void __attribute__ ((used)) profile_sample(uint32_t *frame) {
+    uint32_t offset = frame[FRAME_PC] - (uint32_t)&_stext;
+    uint32_t bucket = offset >> bucket_shift;
+
+    samples++;
+    if (bucket >= PROFILE_BUCKETS || histogram[bucket] == UINT16_MAX) {
+        outside++;
+    } else {
+        histogram[bucket]++;
+    }
+
+    /*
+     * Keeps the SysTick fallback of chip_cycle_count() monotonic. It masks
+     * interrupts while it updates, so this cannot land in the middle of a
+     * read from thread mode.
+     */
+    chip_cycle_count();
+}
+
+/**
+ * @brief SysTick handler
+ *
+ * The boot ROM only uses the main stack, so the frame is at MSP. The branch
+ * leaves the EXC_RETURN value in lr for profile_sample() to return with.
+ */
+static void __attribute__ ((naked)) profile_tick_handler(void) {
+    __asm__ volatile (
+        "mrs r0, msp\n"
+        "b profile_sample\n");
+}
+
+/**
+ * @brief Start sampling
+ *
+ * Call after chip_cycle_counter_init(), which may be using SysTick too.
+ */
+void chip_profile_start(void) {
+    uint32_t text_size = &_etext - &_stext;
+
+    memset(histogram, 0, sizeof(histogram));
+    samples = 0;
+    outside = 0;
+
+    /* Smallest power-of-2 bucket size that covers all of .text */
+    bucket_shift = PROFILE_MIN_SHIFT;
+    while ((text_size >> bucket_shift) >= PROFILE_BUCKETS) {
+        bucket_shift++;
+    }
+
+    saved_vtor = getreg32(SCB_VTOR);
+    memcpy(vectors, (void *)saved_vtor, sizeof(vectors));
+    vectors[VECTOR_SYSTICK] = (uint32_t)profile_tick_handler;
+    putreg32((uint32_t)vectors, SCB_VTOR);
+
+    saved_syst_csr = getreg32(SYST_CSR);
+    saved_syst_rvr = getreg32(SYST_RVR);
+    tsb_systick_set_reload(PROFILE_PERIOD - 1);
+    putreg32(SYST_CSR_CLKSOURCE | SYST_CSR_TICKINT | SYST_CSR_ENABLE,
+             SYST_CSR);
+}
+
+/**
+ * @brief Stop sampling and put SysTick and the vector table back
+ */
+void chip_profile_stop(void) {
+    putreg32(getreg32(SYST_CSR) & ~SYST_CSR_TICKINT, SYST_CSR);
+    tsb_systick_set_reload(saved_syst_rvr);
+    putreg32(saved_syst_csr, SYST_CSR);
+    putreg32(saved_vtor, SCB_VTOR);
+}
+
+/**
+ * @brief Print the histogram for tools/profmap
+ *
+ * Only buckets with samples are printed, as "<address> <count>" lines
+ * between a header and an end line.
+ */
+void chip_profile_report(void) {
+    uint32_t bucket;
+
+    dbgprintx32("PROFILE base ", (uint32_t)&_stext, "");
+    dbgprintx32(" shift ", bucket_shift, "");
+    dbgprintx32(" samples ", samples, "");
+    dbgprintx32(" outside ", outside, "\n");
+    for (bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+        if (histogram[bucket] != 0) {
+            dbgprintx32("", (uint32_t)&_stext + (bucket << bucket_shift), "");
+            dbgprintx32(" ", histogram[bucket], "\n");
+        }
+    }
+    dbgprint("PROFILE end\n");
+    dbgflush();
+}
+
+#endif /* _PROFILE */
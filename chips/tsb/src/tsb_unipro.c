@@ -40,77 +40,104 @@ struct cport cporttable[4] = {
     DECLARE_CPORT(0),  DECLARE_CPORT(1),  DECLARE_CPORT(2),  DECLARE_CPORT(3),
 };
 
-#define CPORT_SW_RESET_BITS 3
+#define CPORT_ALL_MASK      ((1U << CPORT_MAX) - 1)
+
+/* Transport attributes cleared for each CPort being reset */
+static const uint16_t cport_reset_attrs[] = {
+    T_CONNECTIONSTATE,
+    T_LOCALBUFFERSPACE,
+    T_PEERBUFFERSPACE,
+    T_CREDITSTOSEND,
+};
+
+/*
+ * CPorts which may hold connection state and so need a reset before the
+ * next user gets the link. Nothing is known about what ran before us, so
+ * start out assuming all of them; a CPort is added back whenever its RX
+ * is (re)armed, and dropped once it has been reset.
+ */
+static uint32_t cports_in_use = CPORT_ALL_MASK;
+
 /*** TODO: Cross-reference table in spec about what steps need to be done. */
-static int tsb_unipro_reset_cport(uint32_t cportid) {
+static int tsb_unipro_reset_cports(uint32_t cport_mask) {
+    struct unipro_attr_req reqs[CPORT_MAX * ARRAY_SIZE(cport_reset_attrs)];
+    struct unipro_attr_req *req = reqs;
+    uint32_t cportid;
+    unsigned int i;
     int rc;
-    uint32_t tx_reset_offset, rx_reset_offset;
-    uint32_t tx_queue_empty_offset, tx_queue_empty_bit;
 
-    if (cportid >= CPORT_MAX) {
-        return -EINVAL;
+    cport_mask &= CPORT_ALL_MASK;
+    if (!cport_mask) {
+        return 0;
     }
 
-    tx_queue_empty_offset = CPB_TXQUEUEEMPTY_0 + ((cportid >> 5) << 2);
-    tx_queue_empty_bit = (1 << (cportid & 31));
-
-    while (!(getreg32(AIO_UNIPRO_BASE + tx_queue_empty_offset) &
-                tx_queue_empty_bit)) {
+    /* All of our CPorts live in the first TX queue empty register */
+    while ((tsb_unipro_read(CPB_TXQUEUEEMPTY_0) & cport_mask) != cport_mask) {
     }
 
-    tx_reset_offset = TX_SW_RESET_00 + (cportid << 2);
-    rx_reset_offset = RX_SW_RESET_00 + (cportid << 2);
-
-    putreg32(CPORT_SW_RESET_BITS,
-             (volatile unsigned int*)(AIO_UNIPRO_BASE + tx_reset_offset));
-
-    rc = chip_unipro_attr_write(T_CONNECTIONSTATE, 0, cportid, ATTR_LOCAL);
-    if (rc) {
-        dbgprint("error resetting T_CONNECTIONSTATE\n");
-        return -EIO;
+    for (cportid = 0; cportid < CPORT_MAX; cportid++) {
+        if (!(cport_mask & (1 << cportid))) {
+            continue;
+        }
+        tsb_unipro_write(TX_SW_RESET_00 + (cportid << 2),
+                         CPORT_SW_RESET_BITS);
+
+        for (i = 0; i < ARRAY_SIZE(cport_reset_attrs); i++, req++) {
+            req->attr = cport_reset_attrs[i];
+            req->selector = cportid;
+            req->val = 0;
+            req->peer = ATTR_LOCAL;
+            req->write = 1;
+        }
     }
 
-    rc = chip_unipro_attr_write(T_LOCALBUFFERSPACE, 0, cportid, ATTR_LOCAL);
+    rc = chip_unipro_attr_access_batch(reqs, req - reqs);
     if (rc) {
-        dbgprint("error resetting T_LOCALBUFFERSPACE\n");
+        dbgprintx32("error resetting CPort T_* attributes: ", rc, "\n");
         return -EIO;
     }
 
-    rc = chip_unipro_attr_write(T_PEERBUFFERSPACE, 0, cportid, ATTR_LOCAL);
-    if (rc) {
-        dbgprint("error resetting T_PEERBUFFERSPACE\n");
-        return -EIO;
+    for (cportid = 0; cportid < CPORT_MAX; cportid++) {
+        if (cport_mask & (1 << cportid)) {
+            tsb_unipro_write(RX_SW_RESET_00 + (cportid << 2),
+                             CPORT_SW_RESET_BITS);
+        }
     }
-
-    rc = chip_unipro_attr_write(T_CREDITSTOSEND, 0, cportid, ATTR_LOCAL);
-    if (rc) {
-        dbgprint("error resetting T_CREDITSTOSEND\n");
-        return -EIO;
+    for (cportid = 0; cportid < CPORT_MAX; cportid++) {
+        if (cport_mask & (1 << cportid)) {
+            tsb_unipro_write(TX_SW_RESET_00 + (cportid << 2), 0);
+            tsb_unipro_write(RX_SW_RESET_00 + (cportid << 2), 0);
+        }
     }
 
-    putreg32(CPORT_SW_RESET_BITS,
-             (volatile unsigned int*)(AIO_UNIPRO_BASE + rx_reset_offset));
-    putreg32(0, (volatile unsigned int*)(AIO_UNIPRO_BASE + tx_reset_offset));
-    putreg32(0, (volatile unsigned int*)(AIO_UNIPRO_BASE + rx_reset_offset));
+    cports_in_use &= ~cport_mask;
     return 0;
 }
 
 int tsb_reset_all_cports(void) {
-    uint32_t i;
     int rc;
 
-    for (i = 0; i < CPORT_MAX; i++) {
-        rc = tsb_unipro_reset_cport(i);
-        if (rc) {
-            dbgprintx32("Failed to reset cport 0x", i, "\n");
-            return rc;
-        }
+    rc = tsb_unipro_reset_cports(CPORT_ALL_MASK);
+    if (rc) {
+        dbgprint("Failed to reset cports\n");
+        return rc;
     }
     dbgprint("Reset all cports.\n");
 
     return 0;
 }
 
+int tsb_reset_cports_in_use(void) {
+    int rc;
+
+    rc = tsb_unipro_reset_cports(cports_in_use);
+    if (rc) {
+        dbgprintx32("Failed to reset cports 0x", cports_in_use, "\n");
+    }
+
+    return rc;
+}
+
 /**
  * @brief Initialize a specific CPort
  */
@@ -178,12 +205,155 @@ void tsb_unipro_write(uint32_t offset, uint32_t v) {
     putreg32(v, (volatile unsigned int*)(AIO_UNIPRO_BASE + offset));
 }
 
+/**
+ * @brief Load up to A2D_ATTRACS_MAX_SLOTS requests and run them together
+ */
+static int tsb_unipro_attr_access_slots(struct unipro_attr_req *reqs,
+                                        unsigned int count) {
+    unsigned int i;
+    uint32_t sts = 0;
+    int rc;
+
+    for (i = 0; i < count; i++) {
+        tsb_unipro_write(A2D_ATTRACS_CTRL_00 + (i << 2),
+                         REG_ATTRACS_CTRL_PEERENA(reqs[i].peer) |
+                         REG_ATTRACS_CTRL_SELECT(reqs[i].selector) |
+                         REG_ATTRACS_CTRL_WRITE(reqs[i].write) |
+                         reqs[i].attr);
+        if (reqs[i].write) {
+            tsb_unipro_write(A2D_ATTRACS_DATA_CTRL_00 + (i << 2),
+                             reqs[i].val);
+        }
+    }
+
+    /* Start all of the accesses at once */
+    tsb_unipro_write(A2D_ATTRACS_MSTR_CTRL,
+                     REG_ATTRACS_CNT(count) | REG_ATTRACS_UPD);
+
+    while (!tsb_unipro_read(A2D_ATTRACS_INT_BEF))
+        ;
+
+    /* Clear status bit */
+    tsb_unipro_write(A2D_ATTRACS_INT_BEF, 0x1);
+
+    for (i = 0; i < count; i++) {
+        if ((i & 7) == 0) {
+            sts = tsb_unipro_read(REG_ATTRACS_STS(i));
+        }
+        rc = (sts >> REG_ATTRACS_STS_SHIFT(i)) & REG_ATTRACS_STS_MASK;
+        if (rc) {
+            return rc;
+        }
+        if (!reqs[i].write) {
+            reqs[i].val = tsb_unipro_read(A2D_ATTRACS_DATA_STS_00 + (i << 2));
+        }
+    }
+
+    return 0;
+}
+
+int tsb_unipro_attr_access_batch(struct unipro_attr_req *reqs,
+                                 unsigned int count) {
+    unsigned int n;
+    int rc;
+
+    while (count) {
+        n = count > A2D_ATTRACS_MAX_SLOTS ? A2D_ATTRACS_MAX_SLOTS : count;
+        rc = tsb_unipro_attr_access_slots(reqs, n);
+        if (rc) {
+            return rc;
+        }
+        reqs += n;
+        count -= n;
+    }
+
+    return 0;
+}
+
 void tsb_unipro_restart_rx(struct cport *cport) {
     unsigned int cportid = cport->cportid;
 
-    tsb_unipro_write(AHM_ADDRESS_00 + (cportid << 2), (uint32_t)cport->rx_buf);
+    cports_in_use |= (1 << cportid);
+
+    tsb_unipro_write(AHM_ADDRESS_00 + (cportid << 2),
+                     (uint32_t)(cport->rx_buf +
+                                cport->rx_half * CPORT_RX_BUF_HALF_SIZE));
     tsb_unipro_write(REG_RX_PAUSE_SIZE_00 + (cportid << 2),
-                 RX_PAUSE_RESTART | CPORT_RX_BUF_SIZE);
+                 RX_PAUSE_RESTART | CPORT_RX_BUF_HALF_SIZE);
+}
+
+/* Per-CPort bits in AHM_RX_EOM_INT_BEF_0 and AHM_RX_EOT_INT_BEF_0 */
+#define RX_EOM_NOM_BIT(cportid)  (0x01 << ((cportid) << 1))
+#define RX_EOM_ERR_BIT(cportid)  (0x10 << ((cportid) << 1))
+#define RX_EOT_BIT(cportid)      (1 << (cportid))
+
+int tsb_unipro_receive_any(const struct unipro_rx_dispatch *rx,
+                           unsigned int count) {
+    uint32_t bytes_received;
+    struct cport *cport;
+    unsigned int cportid;
+    unsigned int i;
+    uint8_t *data;
+    uint32_t eom;
+    uint32_t eot;
+    int handled = 0;
+
+    /* With nothing to listen on, the wait below would never end */
+    if (rx == NULL || count == 0) {
+        return -EINVAL;
+    }
+
+    for (i = 0; i < count; i++) {
+        if (!cport_handle(rx[i].cportid)) {
+            return -1;
+        }
+    }
+
+    while (handled == 0) {
+        eom = tsb_unipro_read(AHM_RX_EOM_INT_BEF_0);
+        eot = tsb_unipro_read(AHM_RX_EOT_INT_BEF_0);
+
+        for (i = 0; i < count; i++) {
+            cportid = rx[i].cportid;
+
+            if ((eom & RX_EOM_ERR_BIT(cportid)) != 0) {
+                dbgprint("UniPro RX error\n");
+                return -1;
+            }
+            if ((eot & RX_EOT_BIT(cportid)) != 0) {
+                dbgprint("data received exceeded max length\n");
+                return -1;
+            }
+            if ((eom & RX_EOM_NOM_BIT(cportid)) == 0) {
+                continue;
+            }
+
+            cport = cport_handle(cportid);
+            bytes_received = tsb_unipro_read(CPB_RX_TRANSFERRED_DATA_SIZE_00 +
+                                             (cportid << 2));
+            tsb_unipro_write(AHM_RX_EOM_INT_BEF_0, RX_EOM_NOM_BIT(cportid));
+
+            /*
+             * Let the next message land in the other half while the handler
+             * works on this one.
+             */
+            data = cport->rx_buf + cport->rx_half * CPORT_RX_BUF_HALF_SIZE;
+            cport->rx_half ^= 1;
+            tsb_unipro_restart_rx(cport);
+            handled++;
+
+            if (rx[i].handler != NULL) {
+                if (0 != rx[i].handler(cportid,
+                                       data,
+                                       bytes_received)) {
+                    dbgprint("RX handler returned error\n");
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return handled;
 }
 
 /**
@@ -202,7 +372,171 @@ void tsb_reset_before_ready(void) {
 }
 
 void tsb_reset_before_jump(void) {
-    tsb_reset_all_cports();
+    tsb_reset_cports_in_use();
+}
+
+/* Bounds of the delay between reads when polling an attribute */
+#define UNIPRO_WAIT_BACKOFF_MIN_NS  1000
+#define UNIPRO_WAIT_BACKOFF_MAX_NS  64000
+
+static bool tsb_unipro_attr_done(uint32_t val, uint32_t mask, uint32_t value,
+                                 int cond) {
+    if (cond == UNIPRO_WAIT_EQ) {
+        return (val & mask) == value;
+    }
+    return (val & mask) != value;
+}
+
+#ifdef CONFIG_UNIPRO_EVENT_WAIT
+/*
+ * How long the event wait sleeps before handing over to polling, should the
+ * interrupt never arrive. SysTick wakes the WFE at least every tick so the
+ * deadline can be checked. In CPU_CLOCK_MHZ cycles: 10ms, in 2.5ms ticks.
+ */
+#define UNIPRO_WAIT_EVENT_TIMEOUT   (10000 * CPU_CLOCK_MHZ)
+#define UNIPRO_WAIT_EVENT_TICK      (UNIPRO_WAIT_EVENT_TIMEOUT / 4)
+
+/**
+ * @brief Check if a change to an attribute raises the UniPro interrupt
+ *
+ * Mailbox traffic shows up in TSB_INTERRUPTSTATUS and link startup has its
+ * own LUP interrupt; a peer's attributes never interrupt us.
+ */
+static bool tsb_unipro_attr_has_event(uint16_t attr, int peer) {
+    return peer == ATTR_LOCAL &&
+           (attr == TSB_INTERRUPTSTATUS || attr == TSB_POWERSTATE);
+}
+
+/**
+ * @brief Sleep on the UniPro interrupt until the condition holds
+ *
+ * No handler is installed: with SEVONPEND set, the interrupt going pending
+ * in the NVIC is enough to wake the WFE, and we clear it again ourselves.
+ * Pending state is cleared before each read, so a change landing between
+ * the read and the WFE still leaves an event latched.
+ *
+ * Interrupts are masked for the duration so that the SysTick tick that
+ * bounds the wait only wakes the WFE; the profiler, if running, already
+ * ticks and is left to it. SysTick's pending state is cleared on every pass
+ * too, or only its first tick would ever wake the WFE. Each tick seen also
+ * counts towards the timeout, so that it holds even if chip_cycle_count(),
+ * counting with SysTick, misses a wrap while the core sleeps.
+ * @return 0 once the condition holds, -ETIMEDOUT if it didn't in time,
+ *         else as chip_unipro_attr_read()
+ */
+static int tsb_unipro_attr_wait_event(uint16_t attr, uint16_t selector,
+                                      uint32_t mask, uint32_t value,
+                                      int cond, uint32_t *result) {
+    uint32_t scr = getreg32(SCB_SCR);
+    uint32_t unipro_int_en = tsb_unipro_read(UNIPRO_INT_EN);
+    uint32_t lup_int_en = tsb_unipro_read(LUP_INT_EN);
+    uint32_t syst_csr = getreg32(SYST_CSR);
+    uint32_t syst_rvr = getreg32(SYST_RVR);
+    bool own_tick = (syst_csr & SYST_CSR_TICKINT) == 0;
+    uint32_t tick_cycles;
+    uint32_t ticked = 0;
+    uint32_t start;
+    uint32_t primask;
+    uint32_t val;
+    int rc;
+
+    __asm__ volatile ("mrs %0, primask\n"
+                      "cpsid i" : "=r" (primask) :: "memory");
+    if (own_tick) {
+        tsb_systick_set_reload(UNIPRO_WAIT_EVENT_TICK - 1);
+        putreg32(SYST_CSR_CLKSOURCE | SYST_CSR_TICKINT | SYST_CSR_ENABLE,
+                 SYST_CSR);
+    }
+    putreg32(scr | SCB_SCR_SEVONPEND, SCB_SCR);
+    tsb_unipro_write(UNIPRO_INT_EN, 1);
+    tsb_unipro_write(LUP_INT_EN, LUP_DONE_INT_BEF);
+
+    tick_cycles = getreg32(SYST_RVR) + 1;
+    start = chip_cycle_count();
+    while (1) {
+        tsb_unipro_write(UNIPRO_INT_BEF, 1);
+        tsb_unipro_write(LUP_INT_BEF, LUP_DONE_INT_BEF);
+        putreg32(NVIC_IRQ_BIT(TSB_IRQ_UNIPRO), NVIC_ICPR(TSB_IRQ_UNIPRO));
+        if ((getreg32(SCB_ICSR) & SCB_ICSR_PENDSTSET) != 0) {
+            ticked += tick_cycles;
+        }
+        putreg32(SCB_ICSR_PENDSTCLR, SCB_ICSR);
+
+        rc = chip_unipro_attr_read(attr, &val, selector, ATTR_LOCAL);
+        if (rc) {
+            break;
+        }
+        if (tsb_unipro_attr_done(val, mask, value, cond)) {
+            if (result) {
+                *result = val;
+            }
+            break;
+        }
+        if (ticked >= UNIPRO_WAIT_EVENT_TIMEOUT ||
+            chip_cycle_count() - start >= UNIPRO_WAIT_EVENT_TIMEOUT) {
+            rc = -ETIMEDOUT;
+            break;
+        }
+
+        __asm__ volatile ("wfe");
+    }
+
+    /* Leave the interrupts as we found them for whoever runs next */
+    tsb_unipro_write(LUP_INT_EN, lup_int_en);
+    tsb_unipro_write(UNIPRO_INT_EN, unipro_int_en);
+    putreg32(NVIC_IRQ_BIT(TSB_IRQ_UNIPRO), NVIC_ICPR(TSB_IRQ_UNIPRO));
+    putreg32(scr, SCB_SCR);
+    if (own_tick) {
+        putreg32(syst_csr, SYST_CSR);
+        tsb_systick_set_reload(syst_rvr);
+        putreg32(SCB_ICSR_PENDSTCLR, SCB_ICSR);
+    }
+    __asm__ volatile ("msr primask, %0" :: "r" (primask) : "memory");
+
+    return rc;
+}
+#endif
+
+int chip_unipro_attr_wait(uint16_t attr,
+                          uint16_t selector,
+                          int peer,
+                          uint32_t mask,
+                          uint32_t value,
+                          int cond,
+                          uint32_t *result) {
+    uint32_t backoff = UNIPRO_WAIT_BACKOFF_MIN_NS;
+    uint32_t val;
+    int rc;
+
+#ifdef CONFIG_UNIPRO_EVENT_WAIT
+    if (tsb_unipro_attr_has_event(attr, peer)) {
+        rc = tsb_unipro_attr_wait_event(attr, selector, mask, value, cond,
+                                        result);
+        if (rc != -ETIMEDOUT) {
+            return rc;
+        }
+        dbgprint("UniPro event wait timed out, polling\n");
+    }
+#endif
+
+    while (1) {
+        rc = chip_unipro_attr_read(attr, &val, selector, peer);
+        if (rc) {
+            return rc;
+        }
+        if (tsb_unipro_attr_done(val, mask, value, cond)) {
+            if (result) {
+                *result = val;
+            }
+            return 0;
+        }
+
+        dbgpoll();
+        delay_ns(backoff);
+        if (backoff < UNIPRO_WAIT_BACKOFF_MAX_NS) {
+            backoff <<= 1;
+        }
+    }
 }
 
 /**
@@ -210,10 +544,7 @@ void tsb_reset_before_jump(void) {
  * so let's have this function shared between ES2 and ES3 here
  */
 void chip_wait_for_link_up(void) {
-    int rc;
-    uint32_t tempval;
-    do {
-        rc = chip_unipro_attr_read(TSB_POWERSTATE, &tempval, 0,
-                                   ATTR_LOCAL);
-    } while (!rc && (tempval != POWERSTATE_LINKUP));
+    chip_unipro_attr_wait(TSB_POWERSTATE, 0, ATTR_LOCAL,
+                          0xFFFFFFFF, POWERSTATE_LINKUP, UNIPRO_WAIT_EQ,
+                          NULL);
 }
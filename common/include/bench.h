@@ -0,0 +1,78 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __COMMON_INCLUDE_BENCH_H
+#define __COMMON_INCLUDE_BENCH_H
+
+#include <stdint.h>
+#include "debug.h"
+
+/*
+ * Kernel microbenchmarks
+ *
+ * "make bench" builds an image whose bootrom_main() runs each hot kernel
+ * of the boot flow on fixed inputs instead of booting, timing it with
+ * chip_cycle_count() (the DWT cycle counter on the chip). Each kernel is
+ * reported as one line on the debug UART:
+ *
+ *   BENCH <kernel> <unit> <units per call> <calls> <cycles>
+ *
+ * where the numbers are hex and cycles is the fastest of BENCH_RUNS runs of
+ * <calls> calls. tools/benchcmp turns the lines into CSV with cycles per
+ * unit, and compares two runs.
+ */
+
+/* Runs of each kernel; the fastest is reported */
+#define BENCH_RUNS      5
+
+typedef void (*bench_kernel)(void);
+
+/**
+ * @brief Time a kernel and report the rest of its BENCH line
+ * @param units Bytes or operations that one call of the kernel processes
+ * @param calls Number of calls to time together
+ * @param kernel The kernel
+ */
+void bench_run(uint32_t units, uint32_t calls, bench_kernel kernel);
+
+/*
+ * The name and unit are string literals, so that they can go through
+ * dbgprint() as tokens.
+ */
+#define BENCH(name, unit, units, calls, kernel) \
+    do { \
+        dbgprint("BENCH " name " " unit); \
+        bench_run(units, calls, kernel); \
+    } while (0)
+
+/**
+ * @brief Run the kernels of the chip-specific code
+ */
+void bench_chip_kernels(void);
+
+#endif /* __COMMON_INCLUDE_BENCH_H */
@@ -29,8 +29,13 @@
 #ifndef __COMMON_INCLUDE_BOOTROM_H
 #define __COMMON_INCLUDE_BOOTROM_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include "debug.h"
+#include "tftf.h"
+#include "crypto.h"
+#include "timeline.h"
+#include "trace.h"
 
 /*
  * Globals shared by source files, but not part of the communication area:
@@ -51,15 +56,62 @@ typedef struct {
     uint32_t resume_address_complement;
 } __attribute__ ((packed)) resume_communication_area;
 
+/*
+ * Record of the last verified image, so that a warm reset can boot it again
+ * from workram instead of reloading it. It sits at the very bottom of the
+ * communication area, where boot.S finds it as _warm_boot_record.
+ *
+ * The record is part of the ABI with the second stage, which finds it at
+ * offset 0 of the communication area. Its layout must not change:
+ *   0x000  marker             WARM_BOOT_MARKER when armed
+ *   0x004  marker_complement  ~marker when armed
+ *   0x008  digest             HASH_DIGEST_SIZE bytes
+ *   0x028  header             TFTF_HEADER_SIZE bytes
+ *   0x228  signature          sizeof(tftf_signature) bytes
+ *
+ * The boot ROM arms the record just before it starts a verified image whose
+ * sections all stay in workram. It does not disarm it again by itself: as
+ * long as the image in workram still matches the record, every reset other
+ * than a power cycle boots it again without reading flash. A second stage
+ * that changes what it should boot into, for instance by updating the flash,
+ * must call disarm_warm_boot() before it resets the chip. Without
+ * CONFIG_WARM_BOOT there is no record, and the call does nothing.
+ */
+#define WARM_BOOT_MARKER    0x4D524157  /* "WARM" */
+
+typedef struct {
+    uint32_t marker;            /* WARM_BOOT_MARKER when the record is armed */
+    uint32_t marker_complement;
+    unsigned char digest[HASH_DIGEST_SIZE];
+    tftf_header header;
+    tftf_signature signature;   /* The signature that verified digest */
+} __attribute__ ((packed)) warm_boot_record;
+/* Compile-time test hack to keep the record where the second stage looks */
+typedef char ___warm_boot_record_test[
+    (offsetof(warm_boot_record, signature) == 0x228) ? 1 : -1];
+
 /*
  * Area of memory used to communicate between boot ROM and second stage FW.
  * This area is located at the highest end of the RAM. So any addition to the
  * area needs to happen BEFORE the existing fields.
  *
+ * The fields proper, the timeline and trace dump included, always fit in the
+ * top COMMUNICATION_AREA_FIELDS_LENGTH bytes, where they were before there
+ * was a warm boot. CONFIG_WARM_BOOT adds WARM_BOOT_AREA_LENGTH below that
+ * for the warm-boot record, which moves the bottom of the area, and so the
+ * top of the space images can load to, down by as much.
+ *
  * NOTE: COMMUNICATION_AREA_LENGTH must match _communication_area_size in
  * common.ld!
  */
-#define COMMUNICATION_AREA_LENGTH   1024
+#define COMMUNICATION_AREA_FIELDS_LENGTH    1024
+#ifdef CONFIG_WARM_BOOT
+#define WARM_BOOT_AREA_LENGTH       1024
+#else
+#define WARM_BOOT_AREA_LENGTH       0
+#endif
+#define COMMUNICATION_AREA_LENGTH   (WARM_BOOT_AREA_LENGTH + \
+                                     COMMUNICATION_AREA_FIELDS_LENGTH)
 #define EUID_LENGTH         8
 #define S2_FW_ID_LENGTH     32
 #define S2_KEY_NAMELENGTH   96
@@ -74,7 +126,21 @@ typedef enum {
     NUMBER_OF_SHARED_FUNCTIONS
 } shared_function_index;
 
+/* Optional fields, in what used to be padding below the original ones */
+#ifdef _TRACE
+#define COMMUNICATION_AREA_TRACE_FIELD      trace_dump_area trace;
+#else
+#define COMMUNICATION_AREA_TRACE_FIELD
+#endif
+#ifdef CONFIG_BOOT_TIMELINE
+#define COMMUNICATION_AREA_TIMELINE_FIELD   boot_timeline timeline;
+#else
+#define COMMUNICATION_AREA_TIMELINE_FIELD
+#endif
+
 #define COMMUNICATION_AREA_DATA_FIELDS \
+    COMMUNICATION_AREA_TRACE_FIELD \
+    COMMUNICATION_AREA_TIMELINE_FIELD \
     void * shared_functions[NUMBER_OF_SHARED_FUNCTIONS]; \
     unsigned char endpoint_unique_id[EUID_LENGTH]; \
     unsigned char stage_2_firmware_identity[S2_FW_ID_LENGTH]; \
@@ -86,7 +152,25 @@ typedef enum {
 typedef struct {
     COMMUNICATION_AREA_DATA_FIELDS;
 } __attribute__ ((packed)) communication_area_defined;
+/* Compile-time test hack to keep the fields out of the warm-boot area */
+typedef char ___communication_area_test[
+    (sizeof(communication_area_defined) <=
+     COMMUNICATION_AREA_FIELDS_LENGTH) ? 1 : -1];
+
+#ifdef CONFIG_WARM_BOOT
+typedef char ___warm_boot_area_test[
+    (sizeof(warm_boot_record) <= WARM_BOOT_AREA_LENGTH) ? 1 : -1];
+
+#define PAD_LENGTH  (COMMUNICATION_AREA_LENGTH - \
+                     sizeof(warm_boot_record) - \
+                     sizeof(communication_area_defined))
 
+typedef struct {
+    warm_boot_record warm_boot;
+    unsigned char padding[PAD_LENGTH];
+    COMMUNICATION_AREA_DATA_FIELDS;
+} __attribute__ ((packed)) communication_area;
+#else
 #define PAD_LENGTH  (COMMUNICATION_AREA_LENGTH - \
                      sizeof(communication_area_defined))
 
@@ -94,8 +178,10 @@ typedef struct {
     unsigned char padding[PAD_LENGTH];
     COMMUNICATION_AREA_DATA_FIELDS;
 } __attribute__ ((packed)) communication_area;
+#endif
 
-extern unsigned char _communication_area;
+/* Sized by the linker script; an array so the compiler knows no bound */
+extern unsigned char _communication_area[];
 
 static inline void *get_shared_function(shared_function_index index) {
     if (index >= NUMBER_OF_SHARED_FUNCTIONS) {
@@ -118,4 +204,17 @@ static inline void set_shared_function(shared_function_index index,
     p->shared_functions[index] = func;
 }
 
+/*
+ * Make the next reset a cold boot. With the marker and its complement both
+ * zero, boot.S clears all of workram and bootrom_main loads from flash or
+ * UniPro again.
+ */
+static inline void disarm_warm_boot(void) {
+#ifdef CONFIG_WARM_BOOT
+    communication_area *p = (communication_area *)&_communication_area;
+    p->warm_boot.marker = 0;
+    p->warm_boot.marker_complement = 0;
+#endif
+}
+
 #endif /* __COMMON_INCLUDE_BOOTROM_H */
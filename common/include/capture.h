@@ -0,0 +1,111 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __COMMON_INCLUDE_CAPTURE_H
+#define __COMMON_INCLUDE_CAPTURE_H
+
+#include <stdint.h>
+
+/*
+ * Greybus traffic capture
+ *
+ * capture_message() appends every CPort message the boot ROM sends or
+ * receives, and every mailbox value it exchanges with the switch, to a log
+ * in RAM: a capture_log_header, then one capture_record followed by its
+ * message bytes per event. Once the log is full, further records are only
+ * counted. On the chip, read the log from capture_log() with the debugger;
+ * the host build writes it to the file given with --capture, and can feed
+ * it back to the boot ROM in place of the AP with --replay.
+ *
+ * Enabled with _CAPTURE=1 on the make command line.
+ */
+
+#define CAPTURE_LOG_MAGIC   "GBCP"
+#define CAPTURE_LOG_VERSION 1
+
+/* Bytes of records the log holds; the host build has room for more */
+#ifndef CAPTURE_LOG_SIZE
+#define CAPTURE_LOG_SIZE    4096
+#endif
+
+/* chip_cycle_count() rate the timestamps count at, as on ES3 */
+#ifndef CAPTURE_CLOCK_MHZ
+#define CAPTURE_CLOCK_MHZ   48
+#endif
+
+/* Record types; the values are part of the log format, so only append */
+typedef enum {
+    CAPTURE_CPORT_RX,       /* arg is the CPort, the message follows */
+    CAPTURE_CPORT_TX,       /* Same as CAPTURE_CPORT_RX */
+    CAPTURE_MAILBOX_RX,     /* arg is the value the switch wrote */
+    CAPTURE_MAILBOX_TX,     /* arg is the value written to the switch */
+    NUMBER_OF_CAPTURE_TYPES
+} capture_type;
+
+typedef struct {
+    char magic[4];          /* CAPTURE_LOG_MAGIC */
+    uint16_t version;       /* CAPTURE_LOG_VERSION */
+    uint16_t clock_mhz;     /* Rate of the record timestamps */
+    uint32_t length;        /* Bytes of records that follow */
+    uint32_t dropped;       /* Records that didn't fit */
+} __attribute__ ((packed)) capture_log_header;
+
+typedef struct {
+    uint8_t type;           /* One of the CAPTURE_xxx above */
+    uint16_t arg;
+    uint16_t length;        /* Bytes of message that follow the record */
+    uint32_t cycles;        /* chip_cycle_count() when it happened */
+} __attribute__ ((packed)) capture_record;
+
+#ifdef _CAPTURE
+/**
+ * @brief Empty the log
+ */
+void capture_init(void);
+
+/**
+ * @brief Append a record and its message to the log, if they fit
+ * @param type One of the CAPTURE_xxx types
+ * @param arg CPort or mailbox value
+ * @param data The message, or NULL
+ * @param length Bytes of message
+ */
+void capture_message(capture_type type, uint16_t arg, const void *data,
+                     uint16_t length);
+
+/**
+ * @brief Get the log, which is its header then header->length bytes
+ */
+capture_log_header *capture_log(void);
+#else
+static inline void capture_init(void) { }
+static inline void capture_message(capture_type type, uint16_t arg,
+                                   const void *data, uint16_t length) { }
+#endif /* _CAPTURE */
+
+#endif /* __COMMON_INCLUDE_CAPTURE_H */
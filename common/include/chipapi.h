@@ -37,7 +37,9 @@ void chip_init(void);
 /* For debug output */
 void chip_dbginit(void);
 void chip_dbgputc(int);
+void chip_dbgpoll(void);
 void chip_dbgflush(void);
+unsigned int chip_dbgtrywrite(const uint8_t *buf, unsigned int len);
 
 /* Used when CONFIG_GPIO=y */
 #ifdef CONFIG_GPIO
@@ -57,6 +59,18 @@ static inline void chip_gpio_direction_out(uint8_t which, uint8_t value) {}
 #if defined(_SIMULATION) && ((BOOT_STAGE == 1) || (BOOT_STAGE == 3))
 void chip_handshake_with_test_controller(void);
 void chip_handshake_boot_status(uint32_t status);
+void chip_phase_marker(uint8_t phase, uint8_t type);
+#endif
+
+/* Used when built with _PROFILE=1 */
+#ifdef _PROFILE
+void chip_profile_start(void);
+void chip_profile_stop(void);
+void chip_profile_report(void);
+#else
+static inline void chip_profile_start(void) { }
+static inline void chip_profile_stop(void) { }
+static inline void chip_profile_report(void) { }
 #endif
 
 int chip_validate_data_load_location(void *base, uint32_t length);
@@ -96,6 +110,72 @@ int chip_unipro_attr_write(uint16_t attr,
                            uint16_t selector,
                            int peer);
 
+/**
+ * @brief a single DME access, as passed to chip_unipro_attr_access_batch()
+ */
+struct unipro_attr_req {
+    uint16_t attr;      /* DME attribute address */
+    uint16_t selector;  /* attribute selector index */
+    uint32_t val;       /* value to write, or where a read lands */
+    uint8_t peer;       /* ATTR_LOCAL or ATTR_PEER */
+    uint8_t write;      /* 1 for a DME set, 0 for a DME get */
+};
+
+#define UNIPRO_ATTR_WRITE(a, s, v, p) \
+    { .attr = (a), .selector = (s), .val = (v), .peer = (p), .write = 1 }
+#define UNIPRO_ATTR_READ(a, s, p) \
+    { .attr = (a), .selector = (s), .val = 0, .peer = (p), .write = 0 }
+
+/**
+ * @brief Perform a list of DME get/set requests in one go
+ *
+ * The requests are issued in order. Read results are stored back into the
+ * val field of the corresponding request.
+ * @param reqs array of requests
+ * @param count number of entries in reqs
+ * @return 0 for success, <0 for internal error, >0 for the UniPro error of
+ *         the first request that failed
+ */
+int chip_unipro_attr_access_batch(struct unipro_attr_req *reqs,
+                                  unsigned int count);
+
+#define UNIPRO_WAIT_EQ 0 /* until (attribute & mask) == value */
+#define UNIPRO_WAIT_NE 1 /* until (attribute & mask) != value */
+/**
+ * @brief Wait for a DME attribute to reach a given state
+ *
+ * Where the chip raises an event when the attribute changes, the wait
+ * sleeps between reads. Otherwise the attribute is polled with a growing,
+ * bounded delay between reads, which is also where a sleeping wait ends up
+ * if the event is slow in coming. There is no timeout.
+ * @param attr DME attribute address
+ * @param selector attribute selector index, or NCP_SELINDEXNULL if none
+ * @param peer 1 if peer access, 0 if local
+ * @param mask bits of the attribute to compare
+ * @param value value to compare the masked attribute against
+ * @param cond UNIPRO_WAIT_EQ or UNIPRO_WAIT_NE
+ * @param result if not NULL, receives the attribute value that met the
+ *        condition
+ * @return 0 once the condition holds, <0 for internal error, >0 for
+ *         UniPro error
+ */
+int chip_unipro_attr_wait(uint16_t attr,
+                          uint16_t selector,
+                          int peer,
+                          uint32_t mask,
+                          uint32_t value,
+                          int cond,
+                          uint32_t *result);
+
+/**
+ * @brief Move the link to the chip's high-speed gear, if it has one
+ *
+ * See unipro_change_power_mode().
+ * @return 0 if the link now runs in HS or the chip leaves it as it is,
+ *         non-zero if the change failed and the link was left as it was
+ */
+int chip_unipro_change_power_mode(void);
+
 /**
  * @brief send data down a CPort
  * @param cportid cport to send down
@@ -123,6 +203,28 @@ typedef int (*unipro_rx_handler)(uint32_t cportid,
  */
 int chip_unipro_receive(unsigned int cportid, unipro_rx_handler handler);
 
+/**
+ * @brief a CPort to listen on and the handler for its messages
+ */
+struct unipro_rx_dispatch {
+    unsigned int cportid;
+    unipro_rx_handler handler;
+};
+
+/**
+ * @brief wait for data from any of a set of cports
+ *
+ * Blocks until at least one of the CPorts has a message, then hands every
+ * message that is ready to its handler, in table order, and restarts RX on
+ * those CPorts.
+ * @param rx CPorts to listen on, with their handlers
+ * @param count number of entries in rx
+ * @return number of messages handled, -EINVAL if rx is NULL or count is 0,
+ *         <0 on other errors
+ */
+int chip_unipro_receive_any(const struct unipro_rx_dispatch *rx,
+                            unsigned int count);
+
 /**
  * @brief advertise the boot status to the switch
  * @param boot_status
@@ -132,6 +234,14 @@ int chip_unipro_receive(unsigned int cportid, unipro_rx_handler handler);
  */
 void chip_advertise_boot_status(uint32_t boot_status);
 
+/**
+ * @brief publish boot metrics where the peer can read them
+ * @param metrics the BOOT_METRICS_xxx words, see timeline.h
+ * @param count number of words
+ * @return 0 on success, <0 on internal error, >0 on UniPro error
+ */
+int chip_advertise_boot_metrics(const uint32_t *metrics, unsigned int count);
+
 /**
  * @brief advertise the boot type to the switch
  * @return 0 on success, <0 on error, >0 for UniPro error
@@ -151,6 +261,37 @@ void chip_reset_before_ready(void);
  */
 int chip_is_key_revoked(int index);
 
+/*
+ * Used when CONFIG_CHIP_CRYPTO is set, by chips that have faster SHA-256
+ * and RSA than the MIRACL code (the host build). crypto.c still publishes
+ * the MIRACL functions to the later stages; only its own hashing and
+ * signature checks go through these.
+ */
+#ifdef CONFIG_CHIP_CRYPTO
+/**
+ * @brief set up the chip's crypto, after crypto_init() has set up MIRACL's
+ */
+void chip_crypto_init(void);
+
+/**
+ * @brief SHA-256, as hash_start(), hash_update() and hash_final()
+ */
+void chip_hash_start(void);
+void chip_hash_update(const unsigned char *data, uint32_t datalen);
+void chip_hash_final(unsigned char *digest);
+
+/**
+ * @brief check an RSA-2048 PKCS #1 v1.5 signature of a SHA-256 digest
+ * @param digest the digest
+ * @param public_key the modulus, most significant byte first
+ * @param signature the signature, most significant byte first
+ * @return 1 if the signature is correct, 0 if not, as MIRACL's rsa_verify()
+ */
+int chip_rsa2048_verify(const unsigned char *digest,
+                        const unsigned char *public_key,
+                        const unsigned char *signature);
+#endif
+
 /*
  * @brief wait for unipro link up sequence to finish
  * This is called when boot ROM needs the link to be ready
@@ -165,6 +306,20 @@ void chip_wait_for_link_up(void);
  */
 int chip_enter_standby(void);
 
+/**
+ * @brief start the free-running cycle counter used for timestamps
+ *
+ * Only the first boot stage starts it; later stages keep counting from where
+ * the previous one left off.
+ */
+void chip_cycle_counter_init(void);
+
+/**
+ * @brief read the free-running cycle counter
+ * @return CPU cycles since chip_cycle_counter_init(), modulo 2^32
+ */
+uint32_t chip_cycle_count(void);
+
 /**
  * @brief delay function
  * Each chip should define a CHIP_NS_TO_DELAY macro to convert ns to the param
@@ -31,15 +31,43 @@
 
 #include "chipapi.h"
 
+/*
+ * With _DEBUG_TOKENS, the strings given to dbgprint() are kept out of the
+ * image: each literal goes into the non-allocated .dbgstr section, and only
+ * its offset in that section is sent, as a DBG_TAG_TOKEN frame. Numbers are
+ * sent in binary too. tools/dbgdecode turns the output back into text using
+ * a copy of .dbgstr extracted at build time. dbgprint() and dbgprintx32()
+ * then only take string literals.
+ */
+#define DBG_TAG_TOKEN   0xA6    /* Followed by a 16-bit token */
+#define DBG_TAG_HEX8    0xA7    /* Followed by 1 byte */
+#define DBG_TAG_HEX32   0xA8    /* Followed by 4 bytes, little-endian */
+#define DBG_TAG_HEX64   0xA9    /* Followed by 8 bytes, little-endian */
+
 #ifdef _DEBUG
     void dbginit(void);
     void dbgputc(int x);
-    void dbgprint(char *str);
     void dbgprinthex8(uint8_t num);
     void dbgprinthex32(uint32_t num);
     void dbgprinthex64(uint64_t num);
+#ifdef _DEBUG_TOKENS
+    void dbgprinttoken(uint32_t token);
+    #define DBG_TOKEN(str) ({ \
+        static const char __dbgstr[] \
+            __attribute__ ((section(".dbgstr"), used)) = str; \
+        (uint32_t)(uintptr_t)__dbgstr; \
+    })
+    #define dbgprint(str) dbgprinttoken(DBG_TOKEN(str))
+    #define dbgprintx32(s1, num, s2) \
+        do { dbgprint(s1); dbgprinthex32(num); dbgprint(s2); } while (0)
+    #define dbgprintx64(s1, num, s2) \
+        do { dbgprint(s1); dbgprinthex64(num); dbgprint(s2); } while (0)
+#else
+    void dbgprint(char *str);
     void dbgprintx32(char * s1, uint32_t num, char * s2);
     void dbgprintx64(char * s1, uint64_t num, char * s2);
+#endif /* _DEBUG_TOKENS */
+    #define dbgpoll() chip_dbgpoll()
     #define dbgflush() chip_dbgflush()
 #else
     static inline void dbginit(void) { }
@@ -50,6 +78,7 @@
     static inline void dbgprinthex64(uint64_t num) { }
     static inline void dbgprintx32(char * s1, uint32_t num, char * s2) { }
     static inline void dbgprintx64(char * s1, uint64_t num, char * s2) { }
+    static inline void dbgpoll(void) { }
     static inline void dbgflush(void) { }
 #endif /* _DEBUG */
 
@@ -30,6 +30,7 @@
 #define __COMMON_INCLUDE_FFFF_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "data_loading.h"
 
 #define FFFF_HEADER_SIZE                  4096
@@ -96,4 +97,7 @@ typedef char ___ffff_header_test[(sizeof (ffff_header) == FFFF_HEADER_SIZE) ?
 int locate_ffff_element_on_storage(data_load_ops *ops,
                                    uint32_t type,
                                    uint32_t *length);
+bool valid_ffff_element(ffff_element_descriptor * element,
+                        ffff_header * header, uint32_t rom_address,
+                        bool *end_of_elements);
 #endif /* __COMMON_INCLUDE_FFFF_H */
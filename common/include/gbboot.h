@@ -65,7 +65,7 @@ struct __attribute__ ((__packed__)) gbboot_firmware_size_request {
 };
 
 struct __attribute__ ((__packed__)) gbboot_firmware_size_response {
-  size_t size;
+  uint32_t size;
 };
 
 struct __attribute__ ((__packed__)) gbboot_get_firmware_request {
@@ -31,6 +31,8 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include "trace.h"
+#include "capture.h"
 
 #define GREYBUS_MAJOR_VERSION        0
 #define GREYBUS_MINOR_VERSION        1
@@ -61,6 +63,28 @@ typedef struct {
 
 #define CONTROL_CPORT 0
 
+/**
+ * @brief Trace and capture a Greybus message sent or received
+ *
+ * @param id TRACE_EVENT_GB_RX or TRACE_EVENT_GB_TX
+ * @param cportid The CPort the message went through
+ * @param data The message, starting with its gb_operation_header
+ * @param len The length of the message
+ */
+static inline void greybus_trace(trace_event_id id, uint32_t cportid,
+                                 const void *data, size_t len) {
+    const gb_operation_header *header = data;
+    uint32_t op = 0;
+
+    if (len >= sizeof(gb_operation_header)) {
+        op = header->type | ((uint32_t)header->status << 8) |
+             ((uint32_t)header->id << 16);
+    }
+    trace_event(id, cportid, op, len);
+    capture_message(id == TRACE_EVENT_GB_TX ? CAPTURE_CPORT_TX :
+                    CAPTURE_CPORT_RX, cportid, data, len);
+}
+
 int control_cport_handler(uint32_t cportid,
                           void *data,
                           size_t len);
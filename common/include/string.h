@@ -29,10 +29,13 @@
 #ifndef __COMMON_INCLUDE_STRING_H
 #define __COMMON_INCLUDE_STRING_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 void *memcpy(void *dest, const void *src, size_t n);
 
 void *memset(void *s, int c, size_t n);
 
+int memcmp(const void *s1, const void *s2, size_t n);
+
 #endif /* __COMMON_INCLUDE_STRING_H */
@@ -104,6 +104,15 @@ typedef struct {
 typedef void (*image_entry_func)(void);
 
 int load_tftf_image(data_load_ops *ops, uint32_t *is_secure_image);
+bool valid_tftf_header(tftf_header * header);
 void jump_to_image(void);
 
+#ifdef CONFIG_WARM_BOOT
+void tftf_arm_warm_boot(void);
+int tftf_warm_boot(uint32_t *boot_status);
+#else
+static inline void tftf_arm_warm_boot(void) { }
+static inline int tftf_warm_boot(uint32_t *boot_status) { return -1; }
+#endif /* CONFIG_WARM_BOOT */
+
 #endif /* __COMMON_INCLUDE_TFTF_H */
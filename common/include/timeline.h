@@ -0,0 +1,148 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __COMMON_INCLUDE_TIMELINE_H
+#define __COMMON_INCLUDE_TIMELINE_H
+
+#include <stdint.h>
+
+/*
+ * Boot phase timeline
+ *
+ * Each boot phase logs a begin and an end event, timestamped with the chip
+ * cycle counter, into a fixed-size table in the communication area. The
+ * next stage firmware can read the table back and report it.
+ */
+
+/* Boot phases; the values are part of the table format, so only append */
+typedef enum {
+    BOOT_PHASE_CHIP_INIT,
+    BOOT_PHASE_EFUSE_INIT,
+    BOOT_PHASE_WARM_BOOT,
+    BOOT_PHASE_FFFF_LOCATE,
+    BOOT_PHASE_TFTF_HEADER,
+    BOOT_PHASE_SECTION_LOAD,    /* arg is the section index */
+    BOOT_PHASE_RSA_VERIFY,      /* arg is the section index */
+    BOOT_PHASE_UNIPRO_READY,
+    BOOT_PHASE_GREYBUS_INIT,
+    BOOT_PHASE_CPORT_RESET,
+    BOOT_PHASE_JUMP,            /* begin only, the end is in the next stage */
+    BOOT_PHASE_RESUME,          /* wake from standby to UniPro back up */
+    NUMBER_OF_BOOT_PHASES
+} boot_phase;
+
+/* Totals kept alongside the events; only append */
+typedef enum {
+    BOOT_COUNTER_HASH_CYCLES,   /* hash_update() is interleaved with loads */
+    BOOT_COUNTER_RSA_CYCLES,
+    BOOT_COUNTER_STORAGE_BYTES, /* Read from SPI flash */
+    BOOT_COUNTER_UNIPRO_BYTES,  /* Firmware received over UniPro */
+    BOOT_COUNTER_UNIPRO_ROUND_TRIPS,
+    BOOT_COUNTER_RETRIES,
+    NUMBER_OF_BOOT_COUNTERS
+} boot_counter;
+
+/* Where the image being started came from */
+#define BOOT_SOURCE_NONE            0
+#define BOOT_SOURCE_SPI             1
+#define BOOT_SOURCE_UNIPRO          2
+#define BOOT_SOURCE_UNIPRO_FALLBACK 3
+#define BOOT_SOURCE_WARM            4
+
+/*
+ * Boot metrics published to the peer with chip_advertise_boot_metrics(), as
+ * 32-bit words in this order
+ */
+#define BOOT_METRICS_VERSION        1
+#define BOOT_METRICS_HEADER         0   /* Version << 24 | source << 16 */
+#define BOOT_METRICS_TOTAL_CYCLES   1
+#define BOOT_METRICS_COUNTERS       2   /* NUMBER_OF_BOOT_COUNTERS words */
+#define NUMBER_OF_BOOT_METRICS      (BOOT_METRICS_COUNTERS + \
+                                     NUMBER_OF_BOOT_COUNTERS)
+
+#define TIMELINE_EVENT_BEGIN    0
+#define TIMELINE_EVENT_END      1
+
+/* Sized so that the table and the trace dump fit in the communication area */
+#define TIMELINE_MAX_EVENTS     60
+
+typedef struct {
+    uint8_t phase;      /* One of the BOOT_PHASE_xxx above */
+    uint8_t type;       /* TIMELINE_EVENT_BEGIN or TIMELINE_EVENT_END */
+    uint16_t arg;
+    uint32_t cycles;    /* chip_cycle_count() when the event happened */
+} __attribute__ ((packed)) timeline_event;
+
+typedef struct {
+    /* Events logged, which may be more than TIMELINE_MAX_EVENTS */
+    uint32_t count;
+    uint32_t boot_source;
+    uint32_t counters[NUMBER_OF_BOOT_COUNTERS];
+    timeline_event events[TIMELINE_MAX_EVENTS];
+} __attribute__ ((packed)) boot_timeline;
+
+#ifdef CONFIG_BOOT_TIMELINE
+/**
+ * @brief Empty the table (first stage only)
+ */
+void timeline_init(void);
+
+/**
+ * @brief Log the beginning of a boot phase
+ */
+void timeline_begin(boot_phase phase, uint16_t arg);
+
+/**
+ * @brief Log the end of a boot phase
+ */
+void timeline_end(boot_phase phase, uint16_t arg);
+
+/**
+ * @brief Add to one of the totals
+ */
+void timeline_count(boot_counter counter, uint32_t n);
+
+/**
+ * @brief Record where the image being started came from
+ */
+void timeline_set_boot_source(uint32_t source);
+
+/**
+ * @brief Publish the boot metrics to the peer
+ */
+void timeline_publish(void);
+#else
+static inline void timeline_init(void) { }
+static inline void timeline_begin(boot_phase phase, uint16_t arg) { }
+static inline void timeline_end(boot_phase phase, uint16_t arg) { }
+static inline void timeline_count(boot_counter counter, uint32_t n) { }
+static inline void timeline_set_boot_source(uint32_t source) { }
+static inline void timeline_publish(void) { }
+#endif /* CONFIG_BOOT_TIMELINE */
+
+#endif /* __COMMON_INCLUDE_TIMELINE_H */
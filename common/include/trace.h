@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __COMMON_INCLUDE_TRACE_H
+#define __COMMON_INCLUDE_TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Binary event trace
+ *
+ * trace_event() stores a fixed-size record in a RAM ring instead of
+ * printing, so tracing costs a few stores rather than a UART wait per
+ * character. The ring is sent to the debug UART a FIFO-full at a time from
+ * trace_poll(), in full by trace_drain(), and on a failed boot its newest
+ * records are copied into the communication area by trace_dump().
+ *
+ * Enabled with _TRACE=1 on the make command line.
+ */
+
+#define TRACE_RECORD_MAGIC  0xA5    /* First byte of every record */
+
+/* Event IDs; the values are part of the record format, so only append */
+typedef enum {
+    TRACE_EVENT_NONE,
+    TRACE_EVENT_GB_RX,      /* arg0 CPort, arg1 type | status << 8 | id << 16,
+                               arg2 length */
+    TRACE_EVENT_GB_TX,      /* Same as TRACE_EVENT_GB_RX */
+    TRACE_EVENT_ERROR,      /* arg1 BRE_xxx error code */
+    TRACE_EVENT_HALT,       /* arg1 boot status */
+    TRACE_EVENT_JUMP,       /* arg1 image entry point */
+    NUMBER_OF_TRACE_EVENTS
+} trace_event_id;
+
+typedef struct {
+    uint8_t magic;          /* TRACE_RECORD_MAGIC */
+    uint8_t id;             /* One of the TRACE_EVENT_xxx above */
+    uint16_t arg0;
+    uint32_t cycles;        /* chip_cycle_count() when the event happened */
+    uint32_t arg1;
+    uint32_t arg2;
+} __attribute__ ((packed)) trace_record;
+
+/* Newest records saved in the communication area by trace_dump() */
+#define TRACE_DUMP_RECORDS  16
+
+typedef struct {
+    /* Records traced, which may be more than TRACE_DUMP_RECORDS */
+    uint32_t count;
+    trace_record records[TRACE_DUMP_RECORDS];   /* Oldest first */
+} __attribute__ ((packed)) trace_dump_area;
+
+#ifdef _TRACE
+/**
+ * @brief Empty the ring and the communication area dump
+ */
+void trace_init(void);
+
+/**
+ * @brief Add a record to the ring, overwriting the oldest if it is full
+ */
+void trace_event(trace_event_id id, uint16_t arg0, uint32_t arg1,
+                 uint32_t arg2);
+
+/**
+ * @brief Send what the UART can take without waiting
+ */
+void trace_poll(void);
+
+/**
+ * @brief Send everything left in the ring and wait for the UART
+ */
+void trace_drain(void);
+
+/**
+ * @brief Copy the newest records into the communication area
+ */
+void trace_dump(void);
+#else
+static inline void trace_init(void) { }
+static inline void trace_event(trace_event_id id, uint16_t arg0,
+                               uint32_t arg1, uint32_t arg2) { }
+static inline void trace_poll(void) { }
+static inline void trace_drain(void) { }
+static inline void trace_dump(void) { }
+#endif /* _TRACE */
+
+#endif /* __COMMON_INCLUDE_TRACE_H */
@@ -167,7 +167,16 @@
 #define PA_TXGEAR                      0x1568
 #define PA_TXTERMINATION               0x1569
 #define PA_HSSERIES                    0x156a
+    #define PA_HS_SERIES_A          (0x1)
+    #define PA_HS_SERIES_B          (0x2)
 #define PA_PWRMODE                     0x1571
+    #define PA_FAST_MODE            (0x1)
+    #define PA_SLOW_MODE            (0x2)
+    #define PA_FASTAUTO_MODE        (0x4)
+    #define PA_SLOWAUTO_MODE        (0x5)
+    #define PA_UNCHANGED            (0x7)
+    #define PA_PWRMODE_TX(m)        ((m) & 0xf)
+    #define PA_PWRMODE_RX(m)        (((m) & 0xf) << 4)
 #define PA_ACTIVERXDATALANES           0x1580
 #define PA_CONNECTEDRXDATALANES        0x1581
 #define PA_RXPWRSTATUS                 0x1582
@@ -316,12 +325,21 @@
     #define INIT_STATUS_FALLLBACK_TRUSTED_UNIPRO_BOOT_FINISHED   (10 << 24)
     #define INIT_STATUS_FALLLBACK_UNTRUSTED_UNIPRO_BOOT_FINISHED (11 << 24)
     #define INIT_STATUS_RESUMED_FROM_STANDBY                     (12 << 24)
+    #define INIT_STATUS_TRUSTED_WARM_BOOT_FINISHED               (13 << 24)
     #define INIT_STATUS_FAILED                                   (0x80000000)
     #define INIT_STATUS_ERROR_MASK                               (0x80000000)
     #define INIT_STATUS_STATUS_MASK                              (0x7f000000)
     #define INIT_STATUS_ERROR_CODE_MASK                          (0x00ffffff)
 #define DME_DDBL2_ENDPOINTID_H      0x6102
 #define DME_DDBL2_ENDPOINTID_L      0x6103
+#define DME_POWERMODEIND            0xd040
+    #define DME_POWERMODEIND_NONE       (0)
+    #define DME_POWERMODEIND_OK         (1 << 1)
+    #define DME_POWERMODEIND_LOCAL      (1 << 2)
+    #define DME_POWERMODEIND_REMOTE     (1 << 3)
+    #define DME_POWERMODEIND_BUSY       (1 << 4)
+    #define DME_POWERMODEIND_CAP_ERR    (1 << 5)
+    #define DME_POWERMODEIND_FATAL_ERR  (1 << 6)
 #define DME_FC0PROTECTIONTIMEOUTVAL 0xd041
 #define DME_TC0REPLAYTIMEOUTVAL     0xd042
 #define DME_AFC0REQTIMEOUTVAL       0xd043
@@ -377,9 +395,25 @@ int ack_mailbox(uint16_t val);
  */
 int write_mailbox(uint32_t val);
 
+/**
+ * @brief Advance readiness as far as possible without blocking.
+ */
+void unipro_ready_poll(void);
+
 /**
  * @brief Abstract out the chip-common parts of advertising readiness.
  */
 int advertise_ready(void);
 
+/**
+ * @brief Move the link to a high-speed gear
+ *
+ * The gear is capped to what both ends can receive; a gear the PHY turns
+ * down is retried one lower. On failure the link stays in its old mode.
+ * @param gear HS gear to ask for, 1-3
+ * @param series PA_HS_SERIES_A or PA_HS_SERIES_B
+ * @return 0 if the link now runs in HS, non-zero if it was left as it was
+ */
+int unipro_change_power_mode(uint32_t gear, uint32_t series);
+
 #endif /* __COMMON_INCLUDE_UNIPRO_H */
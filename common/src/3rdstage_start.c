@@ -60,6 +60,7 @@ void resume_point(void) {
 
     /* handshake with test controller to indicate success */
     chip_handshake_boot_status(0);
+    dbgflush();
     while(1);
 }
 
@@ -85,17 +86,22 @@ int enter_standby(void) {
 void bootrom_main(void) {
 
     chip_init();
+    chip_profile_start();
 
     dbginit();
 
     dbgprint("Hello world from s3fw\n");
 
+    chip_profile_stop();
+    chip_profile_report();
+
 #ifdef _SIMULATION
     /* Handshake with the controller, indicating trying to enter standby */
     chip_handshake_boot_status(0);
     enter_standby();
 #endif
     /* Our work is done */
+    dbgflush();
     while(1);
 }
 
@@ -114,10 +120,16 @@ void set_last_error(uint32_t err) {
         /* Save the error */
         br_errno = err;
         /* Print out the error */
-        dbgprintx32((err_group == BRE_EFUSE_BASE)? "e-Fuse err: ":
-                    (err_group == BRE_TFTF_BASE)? "TFTF err: ":
-                    (err_group == BRE_FFFF_BASE)? "FFFF err: " :
-                    (err_group == BRE_CRYPTO_BASE)? "Crypto err: " : "error: ",
-                    err, "\n");
+        if (err_group == BRE_EFUSE_BASE) {
+            dbgprintx32("e-Fuse err: ", err, "\n");
+        } else if (err_group == BRE_TFTF_BASE) {
+            dbgprintx32("TFTF err: ", err, "\n");
+        } else if (err_group == BRE_FFFF_BASE) {
+            dbgprintx32("FFFF err: ", err, "\n");
+        } else if (err_group == BRE_CRYPTO_BASE) {
+            dbgprintx32("Crypto err: ", err, "\n");
+        } else {
+            dbgprintx32("error: ", err, "\n");
+        }
     }
 }
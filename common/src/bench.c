@@ -0,0 +1,293 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Kernel microbenchmarks, see bench.h. Built with "make bench" in place of
+ * start.c.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "chipapi.h"
+#include "common.h"
+#include "error.h"
+#include "debug.h"
+#include "utils.h"
+#include "ffff.h"
+#include "tftf.h"
+#include "crypto.h"
+#include "bootrom.h"
+#include "bench.h"
+
+/*
+ * A private copy of the MIRACL code, so that its static kernels can be
+ * called directly. Its exported functions are renamed to keep out of the
+ * way of the copy in crypto.c, which the boot uses.
+ */
+#define shs256_init     bench_shs256_init
+#define shs256_process  bench_shs256_process
+#define shs256_hash     bench_shs256_hash
+#define rsa_verify      bench_rsa_verify
+#define output          bench_output
+#define hashit          bench_hashit
+#define pkcs_v15        bench_pkcs_v15
+#define SHA256ID        bench_SHA256ID
+#include "../vendors/MIRACL/bootrom.c"
+
+/* Bytes that each byte-stream kernel processes per call */
+#define BENCH_BUF_SIZE          4096
+/* Elements in the FFFF table and sections in the TFTF header */
+#define BENCH_FFFF_ELEMENTS     16
+#define BENCH_TFTF_SECTIONS     4
+
+extern char _workram_start;
+
+uint32_t br_errno;
+
+static uint8_t bench_src[BENCH_BUF_SIZE];
+static uint8_t bench_dst[BENCH_BUF_SIZE];
+static sha256 bench_sha;
+static BIG bench_n[MODSIZE];
+static BIG bench_s[MODSIZE];
+static BIG bench_c[MODSIZE];
+static char bench_digest[HASH_DIGEST_SIZE];
+static char bench_signature[RSABYTES];
+static ffff_header bench_ffff;
+static tftf_header bench_tftf;
+
+/* Where results go, so the calls can't be optimised away */
+static volatile uint32_t bench_sink;
+
+void bench_run(uint32_t units, uint32_t calls, bench_kernel kernel) {
+    uint32_t best = UINT32_MAX;
+    uint32_t start;
+    uint32_t cycles;
+    uint32_t i;
+    int run;
+
+    /* Warm up, and don't let the time of the dbgprint() count */
+    kernel();
+    dbgflush();
+
+    for (run = 0; run < BENCH_RUNS; run++) {
+        start = chip_cycle_count();
+        for (i = 0; i < calls; i++) {
+            kernel();
+        }
+        cycles = chip_cycle_count() - start;
+        if (cycles < best) {
+            best = cycles;
+        }
+    }
+
+    dbgprintx32(" ", units, "");
+    dbgprintx32(" ", calls, "");
+    dbgprintx32(" ", best, "\n");
+    dbgflush();
+}
+
+static void bench_hash_update(void) {
+    hash_update(bench_src, BENCH_BUF_SIZE);
+}
+
+static void bench_shs256_process_kernel(void) {
+    uint32_t i;
+
+    for (i = 0; i < BENCH_BUF_SIZE; i++) {
+        bench_shs256_process(&bench_sha, bench_src[i]);
+    }
+}
+
+static void bench_shs_transform(void) {
+    uint32_t i;
+
+    for (i = 0; i < BENCH_BUF_SIZE / 64; i++) {
+        shs_transform(&bench_sha);
+    }
+}
+
+static void bench_tr_modmul(void) {
+    tr_modmul(bench_s, bench_s, bench_n, bench_c);
+}
+
+static void bench_tr_rsa_pow(void) {
+    tr_rsa_pow(bench_n, bench_s, bench_c);
+}
+
+static void bench_rsa_verify_kernel(void) {
+    bench_sink = bench_rsa_verify(bench_digest,
+                                  (char *)public_keys[0].key,
+                                  bench_signature);
+}
+
+static void bench_memcpy(void) {
+    memcpy(bench_dst, bench_src, BENCH_BUF_SIZE);
+}
+
+static void bench_memset(void) {
+    memset(bench_dst, 0xFF, BENCH_BUF_SIZE);
+}
+
+static void bench_is_constant_fill(void) {
+    bench_sink = is_constant_fill(bench_dst, BENCH_BUF_SIZE, 0xFF);
+}
+
+/* Validate the table as validate_ffff_header() does */
+static void bench_valid_ffff_element(void) {
+    bool end_of_elements = false;
+    int i;
+
+    for (i = 0; i < BENCH_FFFF_ELEMENTS; i++) {
+        bench_sink = valid_ffff_element(&bench_ffff.elements[i], &bench_ffff,
+                                        0, &end_of_elements);
+    }
+}
+
+static void bench_valid_tftf_header(void) {
+    bench_sink = valid_tftf_header(&bench_tftf);
+}
+
+/**
+ * @brief Fill in the fixed inputs
+ *
+ * The FFFF table and TFTF header are valid, so that the validators run to
+ * the end, as they do for a good image.
+ */
+static void bench_init_inputs(void) {
+    uint32_t workram = (uintptr_t)&_workram_start;
+    uint32_t i;
+
+    for (i = 0; i < BENCH_BUF_SIZE; i++) {
+        bench_src[i] = i * 167 + 13;
+    }
+    memset(bench_dst, 0xFF, BENCH_BUF_SIZE);
+
+    hash_start();
+    bench_shs256_init(&bench_sha);
+
+    /* Any signature below the modulus takes the full exponentiation */
+    for (i = 0; i < sizeof(bench_signature); i++) {
+        bench_signature[i] = i * 151 + 7;
+    }
+    bench_signature[0] = 0;
+    for (i = 0; i < sizeof(bench_digest); i++) {
+        bench_digest[i] = i;
+    }
+    tr_convert((char *)public_keys[0].key, bench_n);
+    tr_convert(bench_signature, bench_s);
+
+    memset(&bench_ffff, 0, sizeof(bench_ffff));
+    memcpy(bench_ffff.sentinel_value, FFFF_SENTINEL_VALUE,
+           FFFF_SENTINEL_SIZE);
+    bench_ffff.flash_capacity = 0x100000;
+    bench_ffff.erase_block_size = 0x1000;
+    bench_ffff.header_size = FFFF_HEADER_SIZE;
+    bench_ffff.flash_image_length = 0x100000;
+    for (i = 0; i < BENCH_FFFF_ELEMENTS; i++) {
+        bench_ffff.elements[i].element_type = FFFF_ELEMENT_DATA;
+        bench_ffff.elements[i].element_id = i;
+        bench_ffff.elements[i].element_length = 0x1000;
+        bench_ffff.elements[i].element_location = 0x2000 * (i + 1);
+    }
+    bench_ffff.elements[i].element_type = FFFF_ELEMENT_END;
+
+    memset(&bench_tftf, 0, sizeof(bench_tftf));
+    memcpy(bench_tftf.sentinel_value, TFTF_SENTINEL_VALUE,
+           TFTF_SENTINEL_SIZE);
+    bench_tftf.header_size = TFTF_HEADER_SIZE;
+    bench_tftf.package_type = FFFF_ELEMENT_STAGE_2_FW;
+    bench_tftf.start_location = workram + 1;
+    for (i = 0; i < BENCH_TFTF_SECTIONS; i++) {
+        bench_tftf.sections[i].section_type = (i == 0) ?
+            TFTF_SECTION_RAW_CODE : TFTF_SECTION_RAW_DATA;
+        bench_tftf.sections[i].section_id = i;
+        bench_tftf.sections[i].section_length = 0x400;
+        bench_tftf.sections[i].section_expanded_length = 0x400;
+        bench_tftf.sections[i].section_load_address = workram + 0x400 * i;
+    }
+    bench_tftf.sections[i].section_type = TFTF_SECTION_END;
+}
+
+/**
+ * @brief Benchmark image "C" entry point
+ *
+ * @param none
+ *
+ * @returns Nothing. Halts once the results are out.
+ */
+void bootrom_main(void) {
+    chip_init();
+    chip_cycle_counter_init();
+
+    dbginit();
+    crypto_init();
+
+    dbgprint("BENCH begin\n");
+    bench_init_inputs();
+
+    BENCH("hash_update", "byte", BENCH_BUF_SIZE, 4, bench_hash_update);
+    BENCH("shs256_process", "byte", BENCH_BUF_SIZE, 4,
+          bench_shs256_process_kernel);
+    BENCH("shs_transform", "byte", BENCH_BUF_SIZE, 4, bench_shs_transform);
+    BENCH("tr_modmul", "op", 1, 4, bench_tr_modmul);
+    BENCH("tr_rsa_pow", "op", 1, 1, bench_tr_rsa_pow);
+    BENCH("rsa_verify", "op", 1, 1, bench_rsa_verify_kernel);
+    BENCH("memcpy", "byte", BENCH_BUF_SIZE, 16, bench_memcpy);
+    BENCH("memset", "byte", BENCH_BUF_SIZE, 16, bench_memset);
+    BENCH("is_constant_fill", "byte", BENCH_BUF_SIZE, 16,
+          bench_is_constant_fill);
+    BENCH("valid_ffff_element", "op", BENCH_FFFF_ELEMENTS, 16,
+          bench_valid_ffff_element);
+    BENCH("valid_tftf_header", "op", 1, 16, bench_valid_tftf_header);
+    bench_chip_kernels();
+
+    if (br_errno != BRE_OK) {
+        /* A validator rejected its input, so its time is meaningless */
+        dbgprintx32("BENCH error ", br_errno, "\n");
+    }
+    dbgprint("BENCH end\n");
+    dbgflush();
+
+#ifndef CONFIG_HOST_LINUX
+    /* Nothing to boot */
+    while(1);
+#endif
+}
+
+/**
+ * @brief Record a boot error
+ *
+ * The benchmark inputs are all valid, so any error is reported at the end.
+ *
+ * @param errno A BRE_xxx error code to save
+ */
+void set_last_error(uint32_t err) {
+    if (br_errno == BRE_OK) {
+        br_errno = err;
+    }
+}
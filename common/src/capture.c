@@ -0,0 +1,86 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "chipapi.h"
+#include "capture.h"
+
+#ifdef _CAPTURE
+
+static struct {
+    capture_log_header header;
+    uint8_t records[CAPTURE_LOG_SIZE];
+} __attribute__ ((packed)) buffer;
+
+void capture_init(void) {
+    memcpy(buffer.header.magic, CAPTURE_LOG_MAGIC, sizeof(buffer.header.magic));
+    buffer.header.version = CAPTURE_LOG_VERSION;
+    buffer.header.clock_mhz = CAPTURE_CLOCK_MHZ;
+    buffer.header.length = 0;
+    buffer.header.dropped = 0;
+}
+
+void capture_message(capture_type type, uint16_t arg, const void *data,
+                     uint16_t length) {
+    capture_record record;
+    uint32_t used = buffer.header.length;
+
+    if (data == NULL) {
+        length = 0;
+    }
+
+    /*
+     * A replay can only follow the session up to the first record missing,
+     * so once one doesn't fit, none of the later ones are kept either.
+     */
+    if (buffer.header.dropped != 0 ||
+        sizeof(record) + length > CAPTURE_LOG_SIZE - used) {
+        buffer.header.dropped++;
+        return;
+    }
+
+    record.type = type;
+    record.arg = arg;
+    record.length = length;
+    record.cycles = chip_cycle_count();
+    memcpy(&buffer.records[used], &record, sizeof(record));
+    used += sizeof(record);
+    if (length != 0) {
+        memcpy(&buffer.records[used], data, length);
+        used += length;
+    }
+    buffer.header.length = used;
+}
+
+capture_log_header *capture_log(void) {
+    return &buffer.header;
+}
+
+#endif /* _CAPTURE */
@@ -32,6 +32,8 @@
 #include "tftf.h"
 #include "debug.h"
 #include "crypto.h"
+#include "chipapi.h"
+#include "timeline.h"
 
 #include "../vendors/MIRACL/bootrom.c"
 
@@ -40,7 +42,7 @@ void (*sha256_process_func)(sha256 *sh,int byte);
 void (*sha256_hash_func)(sha256 *sh,char hash[32]);
 int (*rsa2048_verify_func)(char digest[], char signature[], char public_key[]);
 
-#ifndef _SIMULATION
+#if !defined(_SIMULATION) && !defined(CONFIG_CHIP_CRYPTO)
 static sha256 shctx;
 #endif
 
@@ -53,8 +55,12 @@ static sha256 shctx;
  */
 void hash_start(void) {
 #ifndef _SIMULATION
+#ifdef CONFIG_CHIP_CRYPTO
+    chip_hash_start();
+#else
     sha256_init_func(&shctx);
 #endif
+#endif
 }
 
 
@@ -68,10 +74,16 @@ void hash_start(void) {
  */
 void hash_update(unsigned char *data, uint32_t datalen) {
 #ifndef _SIMULATION
+    uint32_t start = chip_cycle_count();
+#ifdef CONFIG_CHIP_CRYPTO
+    chip_hash_update(data, datalen);
+#else
     uint32_t i;
     for (i = 0; i < datalen; i++) {
         sha256_process_func(&shctx, data[i]);
     }
+#endif
+    timeline_count(BOOT_COUNTER_HASH_CYCLES, chip_cycle_count() - start);
 #endif
 }
 
@@ -85,31 +97,27 @@ void hash_update(unsigned char *data, uint32_t datalen) {
  */
 void hash_final(unsigned char *digest) {
 #ifndef _SIMULATION
+#ifdef CONFIG_CHIP_CRYPTO
+    chip_hash_final(digest);
+#else
     sha256_hash_func(&shctx,(char*)digest);
 #endif
+#endif
 }
 
 static int find_public_key(tftf_signature *signature, const unsigned char **key) {
-    uint32_t *ps, *pk;
-    int i, k;
-    uint32_t size = (sizeof(public_keys[0]) -
-                     sizeof(public_keys[0].key)) /
-                    sizeof(uint32_t);
-
-    ps = (uint32_t *)&(signature->type);
+    int k;
+    /* The type and key name, laid out the same in both (both are packed) */
+    const unsigned char *ps = (const unsigned char *)signature +
+                              offsetof(tftf_signature, type);
+    size_t size = sizeof(public_keys[0]) - sizeof(public_keys[0].key);
 
     for (k = 0; k < number_of_public_keys; k++) {
         if (chip_is_key_revoked(k)) {
             dbgprintx32("Key ", k, " revoked\n");
             continue;
         }
-        pk = (uint32_t *)&public_keys[k];
-        for (i = 0; i < size; i++) {
-            if (ps[i] != pk[i]) {
-                break;
-            }
-        }
-        if (i >= size) {
+        if (memcmp(ps, &public_keys[k], size) == 0) {
             dbgprint("Found pub. key for this sig.\n");
             *key = public_keys[k].key;
             return 0;
@@ -140,14 +148,22 @@ int verify_signature(unsigned char *digest, tftf_signature *signature) {
 #endif
     int ret;
     const unsigned char *public_key;
+    uint32_t start;
 
     if (find_public_key(signature, &public_key)) {
         return -1;
     }
 
+    start = chip_cycle_count();
+#ifdef CONFIG_CHIP_CRYPTO
+    ret = chip_rsa2048_verify(digest, public_key,
+                              signature->signature) ? 0 : -1;
+#else
     ret = rsa2048_verify_func((char *)digest,
                               (char *)public_key,
                               (char *)signature->signature) ? 0 : -1;
+#endif
+    timeline_count(BOOT_COUNTER_RSA_CYCLES, chip_cycle_count() - start);
 
     if (ret) {
         dbgprint("Signature failed\n");
@@ -178,4 +194,7 @@ void crypto_init(void) {
     sha256_process_func = get_shared_function(SHARED_FUNCTION_SHA256_PROCESS);
     sha256_hash_func = get_shared_function(SHARED_FUNCTION_SHA256_HASH);
     rsa2048_verify_func = get_shared_function(SHARED_FUNCTION_RSA2048_VERIFY);
+#ifdef CONFIG_CHIP_CRYPTO
+    chip_crypto_init();
+#endif
 }
@@ -59,6 +59,64 @@ void dbgputc(int x) {
 }
 
 
+#ifdef _DEBUG_TOKENS
+/**
+ * @brief Send bytes as they are, without the "\n" conversion of dbgputc()
+ *
+ * @param buf The bytes to send
+ * @param len The number of bytes in buf
+ *
+ * @returns Nothing
+ */
+static void dbgwrite(const uint8_t *buf, unsigned int len) {
+    /* The frame goes out whole, once there is room for it */
+    while (chip_dbgtrywrite(buf, len) == 0)
+        ;
+}
+
+/**
+ * @brief Send a tagged little-endian number
+ *
+ * @param tag The DBG_TAG_xxx frame type
+ * @param num The number to send
+ * @param size The number of bytes of num to send
+ *
+ * @returns Nothing
+ */
+static void dbgwritetagged(uint8_t tag, uint64_t num, unsigned int size) {
+    uint8_t frame[1 + sizeof(uint64_t)];
+    unsigned int i;
+
+    frame[0] = tag;
+    for (i = 0; i < size; i++) {
+        frame[1 + i] = (num >> (i << 3)) & 0xff;
+    }
+    dbgwrite(frame, 1 + size);
+}
+
+/**
+ * @brief Print out a string by its token
+ *
+ * @param token The offset of the string in the .dbgstr section
+ *
+ * @returns Nothing
+ */
+void dbgprinttoken(uint32_t token) {
+    dbgwritetagged(DBG_TAG_TOKEN, token, sizeof(uint16_t));
+}
+
+void dbgprinthex8(uint8_t num) {
+    dbgwritetagged(DBG_TAG_HEX8, num, sizeof(num));
+}
+
+void dbgprinthex32(uint32_t num) {
+    dbgwritetagged(DBG_TAG_HEX32, num, sizeof(num));
+}
+
+void dbgprinthex64(uint64_t num) {
+    dbgwritetagged(DBG_TAG_HEX64, num, sizeof(num));
+}
+#else
 /**
  * @brief Print out a string
  *
@@ -160,4 +218,6 @@ void dbgprintx64(char * s1, uint64_t num, char * s2) {
     dbgprint(s2);
 }
 
+#endif  /* _DEBUG_TOKENS */
+
 #endif  /* #ifdef _DEBUG */
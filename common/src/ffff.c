@@ -192,8 +192,8 @@ static int validate_ffff_header(ffff_header *header, uint32_t address) {
      * descriptors and the padding) is zero-filled
      */
     if (!is_constant_fill((uint8_t *)element,
-                          (uint32_t)&header->trailing_sentinel_value -
-                              (uint32_t)element,
+                          (uint8_t *)&header->trailing_sentinel_value -
+                              (uint8_t *)element,
                           0x00)) {
         set_last_error(BRE_FFFF_NON_ZERO_PAD);
         return -1;
@@ -257,7 +257,7 @@ static int locate_ffff_table(data_load_ops *ops)
 static int locate_element(data_load_ops *ops,
                           uint32_t type,
                           uint32_t *length) {
-    uint32_t last_possible_element = (uint32_t)ffff.cur_header +
+    uint32_t last_possible_element = (uintptr_t)ffff.cur_header +
                                      ffff.cur_header->header_size -
                                      FFFF_SENTINEL_SIZE -
                                      sizeof(ffff_element_descriptor);
@@ -270,7 +270,7 @@ static int locate_element(data_load_ops *ops,
 
     ffff.cur_element = NULL;
 
-    while ((uint32_t)element <= last_possible_element) {
+    while ((uintptr_t)element <= last_possible_element) {
         if (element->element_type == FFFF_ELEMENT_END) {
             break;
         }
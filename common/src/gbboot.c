@@ -39,9 +39,11 @@
 #include "data_loading.h"
 #include "gbboot.h"
 #include "crypto.h"
+#include "utils.h"
+#include "timeline.h"
 
-#if (GB_MAX_PAYLOAD_SIZE > CPORT_RX_BUF_SIZE)
-    #error "Greybus maximal payload must be smaller than CPort RX buffer"
+#if (GB_MAX_PAYLOAD_SIZE > CPORT_RX_BUF_HALF_SIZE)
+    #error "Greybus maximal payload must be smaller than half a CPort RX buffer"
 #endif
 
 /* We are receiving a firmware package in TFTF format, and not a raw firmware
@@ -57,6 +59,36 @@ static uint8_t responded_op = GB_BOOT_OP_INVALID;
 
 int fw_cport_handler(uint32_t cportid, void *data, size_t len);
 
+/* Number of messages fw_cport_handler() has been given */
+static uint32_t fw_messages;
+
+/**
+ * @brief Wait for the next message on the firmware CPort
+ *
+ * Control CPort requests that arrive in the meantime are served as well.
+ * @return 0 on success, <0 on error
+ */
+static int gbboot_receive(void) {
+    struct unipro_rx_dispatch rx[] = {
+        {gbboot_cportid, fw_cport_handler},
+        {CONTROL_CPORT, control_cport_handler},
+    };
+    uint32_t seen = fw_messages;
+    int rc;
+
+    while (fw_messages == seen) {
+        rc = chip_unipro_receive_any(rx, ARRAY_SIZE(rx));
+        if (rc < 0) {
+            return rc;
+        }
+        trace_poll();
+        dbgpoll();
+    }
+
+    timeline_count(BOOT_COUNTER_UNIPRO_ROUND_TRIPS, 1);
+    return 0;
+}
+
 static int gbboot_get_version(uint32_t cportid, gb_operation_header *header) {
     uint8_t payload[2] = {GB_FIRMWARE_VERSION_MAJOR, GB_FIRMWARE_VERSION_MINOR};
     return greybus_op_response(cportid, header, GB_OP_SUCCESS, payload,
@@ -78,7 +110,7 @@ static int gbboot_firmware_size(uint8_t stage, uint32_t *size) {
         return rc;
     }
 
-    rc = chip_unipro_receive(gbboot_cportid, fw_cport_handler);
+    rc = gbboot_receive();
     if (rc) {
         return rc;
     }
@@ -119,7 +151,7 @@ static int gbboot_get_firmware(uint32_t offset, uint32_t size, void *data,
     fw_get_firmware_buff.buffer = data;
     fw_get_firmware_buff.size   = size;
 
-    rc = chip_unipro_receive(gbboot_cportid, fw_cport_handler);
+    rc = gbboot_receive();
     if (rc) {
         dbgprintx32("FW receive failed: -", -rc, "\n");
         return rc;
@@ -144,6 +176,7 @@ static int gbboot_get_firmware_response(gb_operation_header *header, void *data,
         return -header->status;
     }
     memcpy(fw_get_firmware_buff.buffer, data, fw_get_firmware_buff.size);
+    timeline_count(BOOT_COUNTER_UNIPRO_BYTES, fw_get_firmware_buff.size);
     return 0;
 }
 
@@ -156,7 +189,7 @@ static int gbboot_ready_to_boot(uint8_t status) {
         return rc;
     }
 
-    rc = chip_unipro_receive(gbboot_cportid, fw_cport_handler);
+    rc = gbboot_receive();
     if (rc) {
         return rc;
     }
@@ -175,6 +208,8 @@ static int gbboot_ready_to_boot_response(gb_operation_header *header, void *data
 
 int fw_cport_handler(uint32_t cportid, void *data, size_t len) {
     int rc = 0;
+    fw_messages++;
+    greybus_trace(TRACE_EVENT_GB_RX, cportid, data, len);
     if (cportid != gbboot_cportid) {
         dbgprint("fw_cport_handler: incorrect CPort #");
         return GB_BOOT_ERR_INVALID;
@@ -260,6 +295,11 @@ static int data_load_greybus_init(void) {
         return rc;
     }
 
+    /* A failed switch leaves the link usable in its current mode */
+    if (chip_unipro_change_power_mode()) {
+        dbgprint("Power mode change failed, downloading in current mode\n");
+    }
+
     /* poll until data cport connected */
     while (!manifest_fetched_by_ap() && retries-- > 0) {
         rc = chip_unipro_receive(CONTROL_CPORT, control_cport_handler);
@@ -280,13 +320,21 @@ static int data_load_greybus_init(void) {
         return rc;
     }
 
+    /*
+     * Serve the control CPort until the data CPort is connected, and the data
+     * CPort until the AP asks for our protocol version, whichever way round
+     * their messages arrive.
+     */
+    struct unipro_rx_dispatch rx[] = {
+        {CONTROL_CPORT, control_cport_handler},
+        {gbboot_cportid, fw_cport_handler},
+    };
     retries = CPORT_POLLING_TIMEOUT;
-    while (cport_connected == 0 && retries-- > 0) {
-        rc = chip_unipro_receive(CONTROL_CPORT, control_cport_handler);
-        if (rc == GB_BOOT_ERR_INVALID) {
+    while ((cport_connected == 0 || responded_op != GB_BOOT_OP_AP_READY) &&
+           retries-- > 0) {
+        rc = chip_unipro_receive_any(rx, ARRAY_SIZE(rx));
+        if (rc < 0) {
             dbgprint("Greybus init failed\n");
-        }
-        if (rc) {
             goto protocol_error;
         }
     }
@@ -294,16 +342,6 @@ static int data_load_greybus_init(void) {
         dbgprint("Greybus Control CPort timeout\n");
         return -ETIMEDOUT;
     }
-
-    retries = CPORT_POLLING_TIMEOUT;
-    /* Spin until the AP asks for our protocol version. */
-    while(responded_op != GB_BOOT_OP_AP_READY && retries-- > 0) {
-        rc = chip_unipro_receive(gbboot_cportid, fw_cport_handler);
-        if (rc) {
-            dbgprint("Greybus FW CPort handler failed\n");
-            goto protocol_error;
-        }
-    }
     if(responded_op != GB_BOOT_OP_AP_READY) {
         dbgprint("Greybus FW CPort timed out\n");
         return -ETIMEDOUT;
@@ -110,22 +110,6 @@ static int switch_dme_peer_get(struct fake_switch *sw,
                                  0);
 }
 
-static int switch_set_port_l4attr(struct fake_switch *sw,
-                                  uint8_t portid,
-                                  uint16_t attrid,
-                                  uint16_t selector,
-                                  uint32_t val) {
-    int rc;
-
-    if (portid == SWITCH_PORT_ID) {
-        rc = switch_dme_set(sw, portid, attrid, selector, val);
-    } else {
-        rc = switch_dme_peer_set(sw, portid, attrid, selector, val);
-    }
-
-    return rc;
-}
-
 static int switch_get_port_l4attr(struct fake_switch *sw,
                                   uint8_t portid,
                                   uint16_t attrid,
@@ -142,84 +126,73 @@ static int switch_get_port_l4attr(struct fake_switch *sw,
     return rc;
 }
 
-static int switch_set_pair_attr(struct fake_switch *sw,
-                                struct unipro_connection *c,
-                                uint16_t attrid,
-                                uint32_t val0,
-                                uint32_t val1) {
-    int rc;
-    rc = switch_set_port_l4attr(sw,
-            c->port_id0,
-            attrid,
-            c->cport_id0,
-            val0);
-    if (rc) {
-        return rc;
-    }
-
-    rc = switch_set_port_l4attr(sw,
-            c->port_id1,
-            attrid,
-            c->cport_id1,
-            val1);
-    if (rc) {
-        return rc;
-    }
-
-    return 0;
+/**
+ * @brief Queue a paired attribute write, one half for each end of c
+ * @return the next free request slot
+ */
+static struct unipro_attr_req *switch_queue_pair_attr(
+        struct unipro_attr_req *req,
+        struct unipro_connection *c,
+        uint16_t attrid,
+        uint32_t val0,
+        uint32_t val1) {
+    req->attr = attrid;
+    req->selector = c->cport_id0;
+    req->val = val0;
+    req->peer = (c->port_id0 == SWITCH_PORT_ID) ? ATTR_LOCAL : ATTR_PEER;
+    req->write = 1;
+    req++;
+
+    req->attr = attrid;
+    req->selector = c->cport_id1;
+    req->val = val1;
+    req->peer = (c->port_id1 == SWITCH_PORT_ID) ? ATTR_LOCAL : ATTR_PEER;
+    req->write = 1;
+    return req + 1;
 }
 
+/* Largest number of paired writes queued by switch_cport_connect at once */
+#define CPORT_CONNECT_MAX_PAIRS     8
+
 int switch_cport_connect(struct fake_switch *sw,
                          struct unipro_connection *c) {
     int e2efc_enabled = (!!(c->flags & CPORT_FLAGS_E2EFC) == 1);
     int csd_enabled = (!!(c->flags & CPORT_FLAGS_CSD_N) == 0);
+    struct unipro_attr_req reqs[CPORT_CONNECT_MAX_PAIRS * 2];
+    struct unipro_attr_req *req = reqs;
     int rc = 0;
 
     /* Disable any existing connection(s). */
-    rc = switch_set_pair_attr(sw, c, T_CONNECTIONSTATE, 0, 0);
-    if (rc) {
-        return rc;
-    }
+    req = switch_queue_pair_attr(req, c, T_CONNECTIONSTATE, 0, 0);
 
     /*
      * Point each device at the other.
      */
-    rc = switch_set_pair_attr(sw,
-                              c,
-                              T_PEERDEVICEID,
-                              c->device_id1,
-                              c->device_id0);
-    if (rc) {
-        return rc;
-    }
+    req = switch_queue_pair_attr(req,
+                                 c,
+                                 T_PEERDEVICEID,
+                                 c->device_id1,
+                                 c->device_id0);
 
     /*
      * Point each CPort at the other.
      */
-    rc = switch_set_pair_attr(sw, c, T_PEERCPORTID, c->cport_id1, c->cport_id0);
-    if (rc) {
-        return rc;
-    }
+    req = switch_queue_pair_attr(req, c, T_PEERCPORTID,
+                                 c->cport_id1, c->cport_id0);
 
     /*
      * Match up traffic classes.
      */
-    rc = switch_set_pair_attr(sw, c, T_TRAFFICCLASS, c->tc, c->tc);
-    if (rc) {
-        return rc;
-    }
+    req = switch_queue_pair_attr(req, c, T_TRAFFICCLASS, c->tc, c->tc);
 
     /*
      * Make sure the protocol IDs are equal. (We don't use them otherwise.)
      */
-    rc = switch_set_pair_attr(sw,
-                              c,
-                              T_PROTOCOLID,
-                              CPORT_DEFAULT_T_PROTOCOLID,
-                              CPORT_DEFAULT_T_PROTOCOLID);
-    if (rc) {
-        return rc;
-    }
+    req = switch_queue_pair_attr(req,
+                                 c,
+                                 T_PROTOCOLID,
+                                 CPORT_DEFAULT_T_PROTOCOLID,
+                                 CPORT_DEFAULT_T_PROTOCOLID);
 
     /*
      * Set default TxTokenValue and RxTokenValue values.
@@ -228,24 +201,16 @@ int switch_cport_connect(struct fake_switch *sw,
      * enabled, so don't change them to different values unless you
      * also patch up the E2EFC case, below.
      */
-    rc = switch_set_pair_attr(sw,
-                              c,
-                              T_TXTOKENVALUE,
-                              CPORT_DEFAULT_TOKENVALUE,
-                              CPORT_DEFAULT_TOKENVALUE);
-    if (rc) {
-        return rc;
-    }
-
-    rc = switch_set_pair_attr(sw,
-                              c,
-                              T_RXTOKENVALUE,
-                              CPORT_DEFAULT_TOKENVALUE,
-                              CPORT_DEFAULT_TOKENVALUE);
-    if (rc) {
-        return rc;
-    }
-
+    req = switch_queue_pair_attr(req,
+                                 c,
+                                 T_TXTOKENVALUE,
+                                 CPORT_DEFAULT_TOKENVALUE,
+                                 CPORT_DEFAULT_TOKENVALUE);
+    req = switch_queue_pair_attr(req,
+                                 c,
+                                 T_RXTOKENVALUE,
+                                 CPORT_DEFAULT_TOKENVALUE,
+                                 CPORT_DEFAULT_TOKENVALUE);
 
     /*
      * Set CPort flags.
@@ -253,10 +218,13 @@ int switch_cport_connect(struct fake_switch *sw,
      * (E2EFC needs to be the same on both sides, which is handled by
      * having a single flags value for now.)
      */
-    rc = switch_set_pair_attr(sw, c, T_CPORTFLAGS, c->flags, c->flags);
+    req = switch_queue_pair_attr(req, c, T_CPORTFLAGS, c->flags, c->flags);
+
+    rc = chip_unipro_attr_access_batch(reqs, req - reqs);
     if (rc) {
         return rc;
     }
+    req = reqs;
 
     /*
      * If E2EFC is enabled, or E2EFC is disabled and CSD is enabled,
@@ -284,56 +252,50 @@ int switch_cport_connect(struct fake_switch *sw,
             return rc;
         }
 
-        rc = switch_set_pair_attr(sw,
-                                  c,
-                                  T_LOCALBUFFERSPACE,
-                                  cport0_local,
-                                  cport1_local);
-        if (rc) {
-            return rc;
-        }
+        req = switch_queue_pair_attr(req,
+                                     c,
+                                     T_LOCALBUFFERSPACE,
+                                     cport0_local,
+                                     cport1_local);
     }
 
     /*
      * Ensure the CPorts aren't in test mode.
      */
-    rc = switch_set_pair_attr(sw,
-                              c,
-                              T_CPORTMODE,
-                              CPORT_MODE_APPLICATION,
-                              CPORT_MODE_APPLICATION);
-    if (rc) {
-        return rc;
-    }
+    req = switch_queue_pair_attr(req,
+                                 c,
+                                 T_CPORTMODE,
+                                 CPORT_MODE_APPLICATION,
+                                 CPORT_MODE_APPLICATION);
 
     /*
      * Clear out the credits to send on each side.
      */
-    rc = switch_set_pair_attr(sw, c, T_CREDITSTOSEND, 0, 0);
-    if (rc) {
-        return rc;
-    }
+    req = switch_queue_pair_attr(req, c, T_CREDITSTOSEND, 0, 0);
 
     /*
      * XXX Toshiba-specific TSB_MaxSegmentConfig (move to bridge ASIC code.)
      */
-    rc = switch_set_pair_attr(sw,
-                              c,
-                              TSB_MAXSEGMENTCONFIG,
-                              CPORT_DEFAULT_TSB_MAXSEGMENTCONFIG,
-                              CPORT_DEFAULT_TSB_MAXSEGMENTCONFIG);
+    req = switch_queue_pair_attr(req,
+                                 c,
+                                 TSB_MAXSEGMENTCONFIG,
+                                 CPORT_DEFAULT_TSB_MAXSEGMENTCONFIG,
+                                 CPORT_DEFAULT_TSB_MAXSEGMENTCONFIG);
+
+    rc = chip_unipro_attr_access_batch(reqs, req - reqs);
     if (rc) {
         return rc;
     }
+    req = reqs;
+
     /*
-     * Establish the connections!
+     * Establish the connections! The chip may issue a whole batch before
+     * it looks at any of the results, so this gets a batch of its own,
+     * run only once everything above has been accepted.
      */
-    rc = switch_set_pair_attr(sw, c, T_CONNECTIONSTATE, 1, 1);
-    if (rc) {
-        return rc;
-    }
+    req = switch_queue_pair_attr(req, c, T_CONNECTIONSTATE, 1, 1);
 
-    return rc;
+    return chip_unipro_attr_access_batch(reqs, req - reqs);
 }
 
 int switch_cport_disconnect(struct fake_switch *sw,
@@ -60,6 +60,9 @@ static void server_loop(void);
  */
 void bootrom_main(void) {
     chip_init();
+    chip_cycle_counter_init();
+    trace_init();
+    capture_init();
 
     dbginit();
 
@@ -68,6 +71,7 @@ void bootrom_main(void) {
     chip_wait_for_link_up();
     while(1) {
         server_loop();
+        trace_drain();
     }
 }
 
@@ -95,14 +99,7 @@ struct unipro_connection conn[] = {
 static int server_control_cport_handler(uint32_t cportid,
                                         void *data,
                                         size_t len) {
-    dbgprint("server ctrl cport Rx:");
-    unsigned char *p = (unsigned char *)data;
-    int i;
-    for(i = 0; i < len; i++) {
-        if ((i & 0xF) == 0) dbgprint("\n    ");
-        dbgprinthex8(p[i]);dbgprint(" ");
-    }
-    dbgprint("\n");
+    greybus_trace(TRACE_EVENT_GB_RX, cportid, data, len);
 
     return 0;
 }
@@ -119,16 +116,14 @@ int poke_mailbox(uint32_t val, int peer) {
 
 int wait_for_mailbox_ack(uint32_t wval, int peer) {
     int rc;
-    uint32_t val = 0;
-    do {
-        rc = chip_unipro_attr_read(MBOX_ACK_ATTR, &val, 0, peer);
-    } while (!rc && val != wval);
+
+    rc = chip_unipro_attr_wait(MBOX_ACK_ATTR, 0, peer,
+                               0xFFFFFFFF, wval, UNIPRO_WAIT_EQ, NULL);
     if (rc) {
         return rc;
     }
 
-    val = 0;
-    chip_unipro_attr_write(MBOX_ACK_ATTR, val, 0, peer);
+    chip_unipro_attr_write(MBOX_ACK_ATTR, 0, 0, peer);
     return 0;
 }
 
@@ -188,6 +183,7 @@ static int gb_control(void) {
 
 static bool image_download_finished = false;
 static int stage_to_load;
+static uint32_t bytes_served;
 static int gbboot_get_firmware_size(uint32_t cportid,
                                   gb_operation_header *op_header) {
     int rc;
@@ -217,6 +213,9 @@ static int gbboot_get_firmware(uint32_t cportid,
     uint8_t data[req->size];
 
     rc = spi_ops.load(data, req->size, false);
+    if (rc == 0) {
+        bytes_served += req->size;
+    }
 
     return greybus_op_response(cportid,
                                op_header,
@@ -228,8 +227,19 @@ static int gbboot_get_firmware(uint32_t cportid,
 static int gbboot_ready_to_boot(uint32_t cportid,
                               gb_operation_header *op_header) {
     uint8_t *payload = (uint8_t *)op_header + sizeof(*op_header);
+    uint32_t tx_gear = 0, rx_gear = 0, pwrmode = 0;
     dbgprintx32("ready-to-boot, status: ", *payload, "\n");
 
+    /* Report which mode the image came down in */
+    chip_unipro_attr_read(PA_TXGEAR, &tx_gear, 0, ATTR_LOCAL);
+    chip_unipro_attr_read(PA_RXGEAR, &rx_gear, 0, ATTR_LOCAL);
+    chip_unipro_attr_read(PA_PWRMODE, &pwrmode, 0, ATTR_LOCAL);
+    dbgprintx32("bytes served: ", bytes_served, "\n");
+    dbgprintx32("TX gear: ", tx_gear, "\n");
+    dbgprintx32("RX gear: ", rx_gear, "\n");
+    dbgprintx32("power mode: ", pwrmode, "\n");
+    bytes_served = 0;
+
     image_download_finished = true;
     return greybus_op_response(cportid,
                                op_header,
@@ -241,14 +251,7 @@ static int gbboot_ready_to_boot(uint32_t cportid,
 static int gbboot_cport_handler(uint32_t cportid,
                               void *data,
                               size_t len) {
-    dbgprint("gbboot cport Rx:");
-    unsigned char *p = (unsigned char *)data;
-    int i;
-    for(i = 0; i < len; i++) {
-        if ((i & 0xF) == 0) dbgprint("\n    ");
-        dbgprinthex8(p[i]);dbgprint(" ");
-    }
-    dbgprint("\n");
+    greybus_trace(TRACE_EVENT_GB_RX, cportid, data, len);
 
     int rc = 0;
     if (len < sizeof(gb_operation_header)) {
@@ -292,6 +295,8 @@ static int gbboot_process(void) {
     image_download_finished = false;
     while (!image_download_finished) {
         chip_unipro_receive(gbboot_CPORT, gbboot_cport_handler);
+        trace_poll();
+        dbgpoll();
     }
     return 0;
 }
@@ -339,11 +344,18 @@ void set_last_error(uint32_t err) {
 
         /* Save the error */
         br_errno = err;
+        trace_event(TRACE_EVENT_ERROR, 0, err, 0);
         /* Print out the error */
-        dbgprintx32((err_group == BRE_EFUSE_BASE)? "e-Fuse err: ":
-                    (err_group == BRE_TFTF_BASE)? "TFTF err: ":
-                    (err_group == BRE_FFFF_BASE)? "FFFF err: " :
-                    (err_group == BRE_CRYPTO_BASE)? "Crypto err: " : "error: ",
-                    err, "\n");
+        if (err_group == BRE_EFUSE_BASE) {
+            dbgprintx32("e-Fuse err: ", err, "\n");
+        } else if (err_group == BRE_TFTF_BASE) {
+            dbgprintx32("TFTF err: ", err, "\n");
+        } else if (err_group == BRE_FFFF_BASE) {
+            dbgprintx32("FFFF err: ", err, "\n");
+        } else if (err_group == BRE_CRYPTO_BASE) {
+            dbgprintx32("Crypto err: ", err, "\n");
+        } else {
+            dbgprintx32("error: ", err, "\n");
+        }
     }
 }
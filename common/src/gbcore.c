@@ -65,6 +65,7 @@ static int greybus_send_message(uint32_t cport,
     if (payload_size != 0 && payload_data != NULL) {
         memcpy(payload, payload_data, payload_size);
     }
+    greybus_trace(TRACE_EVENT_GB_TX, cport, msg, sizeof(msg));
     return chip_unipro_send(cport, msg, sizeof(msg));
 }
 
@@ -218,6 +219,8 @@ int control_cport_handler(uint32_t cportid,
 {
     int rc = 0;
 
+    greybus_trace(TRACE_EVENT_GB_RX, cportid, data, len);
+
     /* If the message is longer than the buffer, it will have been rejected by the Rx function
      * If the message is shorter than the buffer but longer than the specific message type,
      * the remainder of the buffer is silently and benignly ignored.
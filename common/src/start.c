@@ -43,6 +43,9 @@
 #include "ffff.h"
 #include "crypto.h"
 #include "bootrom.h"
+#include "timeline.h"
+#include "trace.h"
+#include "capture.h"
 
 extern data_load_ops spi_ops;
 extern data_load_ops greybus_ops;
@@ -51,6 +54,37 @@ uint32_t br_errno;
 
 uint32_t merge_errno_with_boot_status(uint32_t boot_status);
 
+/*
+ * SPI boot goes through these wrappers, which count the bytes read and let
+ * link bring-up progress while the image is read, so that a fallback to
+ * UniPro boot can go straight to the mailbox handshake.
+ */
+static data_load_ops spi_boot_ops;
+
+static int spi_read_and_poll(void *dest, uint32_t addr, uint32_t length) {
+    int rc = spi_ops.read(dest, addr, length);
+
+    timeline_count(BOOT_COUNTER_STORAGE_BYTES, length);
+#ifdef BOOT_OVER_UNIPRO
+    unipro_ready_poll();
+#endif
+    trace_poll();
+    dbgpoll();
+    return rc;
+}
+
+static int spi_load_and_poll(void *dest, uint32_t length, bool hash) {
+    int rc = spi_ops.load(dest, length, hash);
+
+    timeline_count(BOOT_COUNTER_STORAGE_BYTES, length);
+#ifdef BOOT_OVER_UNIPRO
+    unipro_ready_poll();
+#endif
+    trace_poll();
+    dbgpoll();
+    return rc;
+}
+
 
 /**
  * @brief Bootloader "C" entry point
@@ -71,7 +105,18 @@ void bootrom_main(void) {
     /* Ensure that we start each boot with an assumption of success */
     init_last_error();
 
+#if BOOT_STAGE == 1
+    /* Timestamps and the UniPro event-wait timeout count cycles */
+    chip_cycle_counter_init();
+#endif
+    timeline_init();
+    trace_init();
+    capture_init();
+    chip_profile_start();
+
+    timeline_begin(BOOT_PHASE_CHIP_INIT, 0);
     chip_init();
+    timeline_end(BOOT_PHASE_CHIP_INIT, 0);
 
     dbginit();
 
@@ -89,10 +134,17 @@ void bootrom_main(void) {
     chip_handshake_boot_status(0);
 #endif
     /* Our work is done */
+    dbgflush();
     while(1);
 #endif
 
     chip_unipro_init();
+#ifdef BOOT_OVER_UNIPRO
+    unipro_ready_poll();
+#endif
+    spi_boot_ops = spi_ops;
+    spi_boot_ops.read = spi_read_and_poll;
+    spi_boot_ops.load = spi_load_and_poll;
 
     /* Advertise our boot status */
     chip_advertise_boot_status(boot_status);
@@ -106,9 +158,23 @@ void bootrom_main(void) {
      * Validate and make available e-fuse information (it handles error
      * reporting). Note that an error here is unrecoverable.
      */
+    timeline_begin(BOOT_PHASE_EFUSE_INIT, 0);
     if (efuse_init() != 0) {
         halt_and_catch_fire(boot_status);
     }
+    timeline_end(BOOT_PHASE_EFUSE_INIT, 0);
+
+#if BOOT_STAGE == 1 && defined(CONFIG_WARM_BOOT)
+    /* After a warm reset, the last verified image may still be in workram */
+    timeline_begin(BOOT_PHASE_WARM_BOOT, 0);
+    rc = tftf_warm_boot(&boot_status);
+    timeline_end(BOOT_PHASE_WARM_BOOT, 0);
+    if (rc == 0) {
+        timeline_set_boot_source(BOOT_SOURCE_WARM);
+        chip_advertise_boot_status(boot_status);
+        jump_to_image();
+    }
+#endif
 
     /* determine if we're booting from flash or unipro */
     register_val = tsb_get_bootselector();
@@ -120,7 +186,7 @@ void bootrom_main(void) {
     if (boot_from_spi) {
         dbgprint("Boot from SPIROM\n");
 
-        spi_ops.init();
+        spi_boot_ops.init();
 
         /**
          * Call locate_ffff_element_on_storage to locate next stage FW.
@@ -129,11 +195,14 @@ void bootrom_main(void) {
          * the same as BOOT_STAGE
          */
         /*** TODO: Change 2nd param to element type, not BOOT_STAGE - depends on splitting l2fw start */
-        if (locate_ffff_element_on_storage(&spi_ops, BOOT_STAGE, NULL) == 0) {
+        timeline_begin(BOOT_PHASE_FFFF_LOCATE, 0);
+        rc = locate_ffff_element_on_storage(&spi_boot_ops, BOOT_STAGE, NULL);
+        timeline_end(BOOT_PHASE_FFFF_LOCATE, 0);
+        if (rc == 0) {
             boot_status = INIT_STATUS_SPI_BOOT_STARTED;
             chip_advertise_boot_status(boot_status);
-            if (!load_tftf_image(&spi_ops, &is_secure_image)) {
-                spi_ops.finish(true, is_secure_image);
+            if (!load_tftf_image(&spi_boot_ops, &is_secure_image)) {
+                spi_boot_ops.finish(true, is_secure_image);
                 if (is_secure_image) {
                     dbgprint("Trusted image\n");
                     boot_status = INIT_STATUS_TRUSTED_SPI_FLASH_BOOT_FINISHED;
@@ -149,14 +218,19 @@ void bootrom_main(void) {
                 }
                 /* Log that we're starting the boot-from-SPIROM */
                 chip_advertise_boot_status(boot_status);
+#if BOOT_STAGE == 1
+                tftf_arm_warm_boot();
+#endif
+                timeline_set_boot_source(BOOT_SOURCE_SPI);
                 /* TA-16 jump to SPI code (BOOTRET_o = 0 && SPIBOOT_N = 0) */
                 jump_to_image();
             }
         }
         /*****/dbgprint("No image\n");
-        spi_ops.finish(false, false);
+        spi_boot_ops.finish(false, false);
 
         /* Fallback to UniPro boot */
+        timeline_count(BOOT_COUNTER_RETRIES, 1);
         boot_from_spi = false;
         fallback_boot_unipro = true;
 
@@ -180,11 +254,15 @@ void bootrom_main(void) {
         }
         chip_advertise_boot_status(boot_status);
         dbgprint("Boot over UniPro\n");
+        timeline_begin(BOOT_PHASE_UNIPRO_READY, 0);
         advertise_ready();
+        timeline_end(BOOT_PHASE_UNIPRO_READY, 0);
         dbgprint("Ready-poked; download-ready\n");
+        timeline_begin(BOOT_PHASE_GREYBUS_INIT, 0);
         if (greybus_ops.init() != 0) {
             halt_and_catch_fire(boot_status);
         }
+        timeline_end(BOOT_PHASE_GREYBUS_INIT, 0);
         if (!load_tftf_image(&greybus_ops, &is_secure_image)) {
             if (greybus_ops.finish(true, is_secure_image) != 0) {
                 halt_and_catch_fire(boot_status);
@@ -206,6 +284,12 @@ void bootrom_main(void) {
                  */
                 efuse_rig_for_untrusted();
             }
+#if BOOT_STAGE == 1
+            tftf_arm_warm_boot();
+#endif
+            timeline_set_boot_source(fallback_boot_unipro ?
+                                     BOOT_SOURCE_UNIPRO_FALLBACK :
+                                     BOOT_SOURCE_UNIPRO);
             /* TA-17 jump to Workram code (BOOTRET_o = 0 && SPIM_BOOT_N = 1) */
             jump_to_image();
         }
@@ -257,10 +341,16 @@ void halt_and_catch_fire(uint32_t boot_status) {
     boot_status = merge_errno_with_boot_status(boot_status) |
                   INIT_STATUS_FAILED;
     dbgprintx32("Boot failed (", boot_status, ") halt\n");
+    chip_profile_stop();
+    chip_profile_report();
+    trace_event(TRACE_EVENT_HALT, 0, boot_status, 0);
+    trace_dump();
+    trace_drain();
     dbgflush();
     /* NOTE: NO FURTHER DEBUG MESSAGES BETWEEN HERE AND FUNCTION END! */
 
     if (!boot_status_offline) {
+        timeline_publish();
         chip_advertise_boot_status(boot_status);
     }
 
@@ -288,11 +378,18 @@ void set_last_error(uint32_t err) {
 
         /* Save the error */
         br_errno = err;
+        trace_event(TRACE_EVENT_ERROR, 0, err, 0);
         /* Print out the error */
-        dbgprintx32((err_group == BRE_EFUSE_BASE)? "e-Fuse err: ":
-                    (err_group == BRE_TFTF_BASE)? "TFTF err: ":
-                    (err_group == BRE_FFFF_BASE)? "FFFF err: " :
-                    (err_group == BRE_CRYPTO_BASE)? "Crypto err: " : "error: ",
-                    err, "\n");
+        if (err_group == BRE_EFUSE_BASE) {
+            dbgprintx32("e-Fuse err: ", err, "\n");
+        } else if (err_group == BRE_TFTF_BASE) {
+            dbgprintx32("TFTF err: ", err, "\n");
+        } else if (err_group == BRE_FFFF_BASE) {
+            dbgprintx32("FFFF err: ", err, "\n");
+        } else if (err_group == BRE_CRYPTO_BASE) {
+            dbgprintx32("Crypto err: ", err, "\n");
+        } else {
+            dbgprintx32("error: ", err, "\n");
+        }
     }
 }
@@ -37,6 +37,8 @@
 #include "unipro.h"
 #include "utils.h"
 #include "error.h"
+#include "timeline.h"
+#include "trace.h"
 
 #define NEW_VALIDATION
 
@@ -68,12 +70,22 @@ typedef struct {
     unsigned char hash[HASH_DIGEST_SIZE];
     tftf_signature signature;
     bool contain_signature;
+    /* All of the hashed data stays in memory, so it can be re-hashed there */
+    bool resident;
 } tftf_processing_state;
 
 static const char tftf_sentinel[] = TFTF_SENTINEL_VALUE;
 
 static tftf_processing_state tftf;
 
+#ifdef CONFIG_WARM_BOOT
+static warm_boot_record * const warm_boot =
+    &((communication_area *)&_communication_area)->warm_boot;
+
+/* The part of workram a loaded image can occupy */
+extern char _workram_start, _bootrom_data_area;
+#endif
+
 /* Cached values of ARA VID & PID, read from e-Fuse */
 uint32_t ara_vid;
 uint32_t ara_pid;
@@ -83,34 +95,27 @@ uint32_t ara_pid;
  * Prototypes
  */
 bool valid_tftf_header(tftf_header * header);
+static void publish_image_identity(void);
 
-static int load_tftf_header(data_load_ops *ops) {
-    tftf_section_descriptor *section;
+/**
+ * @brief Check that an image is meant for this chip
+ *
+ * The UniPro and Ara VID+PID in the header must match the corresponding
+ * chip VID+PID.
+ *
+ * Note: a 0-valued image VID/PID acts as a wild card and no comparison
+ * takes place for that VID/PID.
+ *
+ * @param header The TFTF header to check
+ *
+ * @returns 0 if the image is for this chip, -1 (with the error set) if not
+ */
+static int check_tftf_vid_pid(tftf_header *header) {
     uint32_t unipro_vid = 0;
     uint32_t unipro_pid = 0;
     int rc;
 
-    tftf.crypto_state = CRYPTO_STATE_INIT;
-    tftf.contain_signature = false;
-
-    if (ops->load(&tftf.header, TFTF_HEADER_SIZE, false)) {
-        set_last_error(BRE_TFTF_LOAD_HEADER);
-        return -1;
-    }
-
-    if (!valid_tftf_header(&tftf.header)) {
-        /* (valid_tftf_header took care of error reporting) */
-        return -1;
-    }
-
-    /*
-     * Check that the UniPro and Ara VID+PID matches the corresponding chip
-     * VID+PID.
-     *
-     * Note: a 0-valued image VID/PID acts as a wild card and no comparison
-     * takes place for that VID/PID.
-     * TA-12 Read  DME attribute (DDBL1)
-     */
+    /* TA-12 Read  DME attribute (DDBL1) */
     rc = chip_unipro_attr_read(DME_DDBL1_MANUFACTURERID, &unipro_vid, 0,
                           ATTR_LOCAL);
     if (rc) {
@@ -122,25 +127,50 @@ static int load_tftf_header(data_load_ops *ops) {
         set_last_error(BRE_EFUSE_UNIPRO_PID_READ);
         return -1;
     }
-    if (((tftf.header.unipro_vid != 0) &&
-         (tftf.header.unipro_vid != unipro_vid)) ||
-        ((tftf.header.unipro_pid != 0) &&
-         (tftf.header.unipro_pid != unipro_pid)) ||
-        ((tftf.header.ara_vid != 0) &&
-         (tftf.header.ara_vid != ara_vid)) ||
-        ((tftf.header.ara_pid != 0) &&
-         (tftf.header.ara_pid != ara_pid))) {
+    if (((header->unipro_vid != 0) &&
+         (header->unipro_vid != unipro_vid)) ||
+        ((header->unipro_pid != 0) &&
+         (header->unipro_pid != unipro_pid)) ||
+        ((header->ara_vid != 0) &&
+         (header->ara_vid != ara_vid)) ||
+        ((header->ara_pid != 0) &&
+         (header->ara_pid != ara_pid))) {
         set_last_error(BRE_TFTF_VIDPID_MISMATCH);
         return -1;
     }
 
+    return 0;
+}
+
+static int load_tftf_header(data_load_ops *ops) {
+    tftf_section_descriptor *section;
+
+    tftf.crypto_state = CRYPTO_STATE_INIT;
+    tftf.contain_signature = false;
+    tftf.resident = true;
+
+    if (ops->load(&tftf.header, TFTF_HEADER_SIZE, false)) {
+        set_last_error(BRE_TFTF_LOAD_HEADER);
+        return -1;
+    }
+
+    if (!valid_tftf_header(&tftf.header)) {
+        /* (valid_tftf_header took care of error reporting) */
+        return -1;
+    }
+
+    if (check_tftf_vid_pid(&tftf.header)) {
+        /* (check_tftf_vid_pid took care of error reporting) */
+        return -1;
+    }
 
      /*
       * Process the TFTF sections
       */
     section = &tftf.header.sections[0];
     while(1) {
-        if ((uint32_t)section - (uint32_t)&tftf.header >= TFTF_HEADER_SIZE) {
+        if ((unsigned char *)section - (unsigned char *)&tftf.header >=
+            TFTF_HEADER_SIZE) {
             set_last_error(BRE_TFTF_HEADER_SIZE);
             return -1;
         }
@@ -164,7 +194,8 @@ static int load_tftf_header(data_load_ops *ops) {
                  */
                 hash_start();
                 tftf.crypto_state = CRYPTO_STATE_HASHING;
-                header_hash_len = (uint32_t)section - (uint32_t)&tftf.header;
+                header_hash_len = (unsigned char *)section -
+                                  (unsigned char *)&tftf.header;
                 hash_update((unsigned char *)&tftf.header, header_hash_len);
             }
             break;
@@ -179,6 +210,9 @@ static int load_tftf_header(data_load_ops *ops) {
                 set_last_error(BRE_TFTF_HASHED_SECTION_AFTER_UNHASHED);
                 return -1;
             }
+            if (section->section_load_address == DATA_ADDRESS_TO_BE_IGNORED) {
+                tftf.resident = false;
+            }
             break;
         }
         section++;
@@ -211,6 +245,7 @@ static int process_tftf_section(data_load_ops *ops,
                                 tftf_section_descriptor *section) {
     unsigned char *dest;
     bool hash_loaded_data = false;
+    int rc;
 
     if ((section->section_type == TFTF_SECTION_SIGNATURE ||
          section->section_type == TFTF_SECTION_CERTIFICATE) &&
@@ -225,46 +260,63 @@ static int process_tftf_section(data_load_ops *ops,
             return -1;
         }
         if (tftf.crypto_state == CRYPTO_STATE_HASHED) {
-            if (verify_signature(tftf.hash, &tftf.signature) == 0) {
+            timeline_begin(BOOT_PHASE_RSA_VERIFY,
+                           section - tftf.header.sections);
+            rc = verify_signature(tftf.hash, &tftf.signature);
+            timeline_end(BOOT_PHASE_RSA_VERIFY,
+                         section - tftf.header.sections);
+            if (rc == 0) {
                 tftf.crypto_state = CRYPTO_STATE_VERIFIED;
+#ifdef CONFIG_WARM_BOOT
+                memcpy(&warm_boot->signature, &tftf.signature,
+                       sizeof(warm_boot->signature));
+#endif
             }
         }
         return 0;
     }
 
-    dest = (unsigned char*)section->section_load_address;
+    dest = (unsigned char *)(uintptr_t)section->section_load_address;
 
     if (tftf.crypto_state == CRYPTO_STATE_HASHING) {
         hash_loaded_data = true;
     }
 
-    if ((uint32_t)dest == DATA_ADDRESS_TO_BE_IGNORED &&
-        discard_section(ops, section, hash_loaded_data)) {
-        set_last_error(BRE_TFTF_LOAD_DATA);
-        return -1;
+    if (section->section_load_address == DATA_ADDRESS_TO_BE_IGNORED) {
+        rc = discard_section(ops, section, hash_loaded_data);
+    } else {
+        rc = ops->load(dest, section->section_length, hash_loaded_data);
     }
-    else if (ops->load(dest, section->section_length, hash_loaded_data)) {
+    if (rc) {
         set_last_error(BRE_TFTF_LOAD_DATA);
         return -1;
     }
 
-
     return 0;
 }
 
 int load_tftf_image(data_load_ops *ops, uint32_t *is_secure_image) {
     tftf_section_descriptor *section;
+    uint16_t index;
+    int rc;
 
     *is_secure_image = 0;
 
-    if (load_tftf_header(ops)) {
+    timeline_begin(BOOT_PHASE_TFTF_HEADER, 0);
+    rc = load_tftf_header(ops);
+    timeline_end(BOOT_PHASE_TFTF_HEADER, 0);
+    if (rc) {
         /* (load_tftf_header took care of error reporting) */
         return -1;
     }
 
     section = &tftf.header.sections[0];
     while(section->section_type != TFTF_SECTION_END) {
-        if (process_tftf_section(ops, section)) {
+        index = section - tftf.header.sections;
+        timeline_begin(BOOT_PHASE_SECTION_LOAD, index);
+        rc = process_tftf_section(ops, section);
+        timeline_end(BOOT_PHASE_SECTION_LOAD, index);
+        if (rc) {
             /* (process_tftf_section took care of error reporting)
              */
             return -1;
@@ -277,6 +329,27 @@ int load_tftf_image(data_load_ops *ops, uint32_t *is_secure_image) {
         *is_secure_image = 1;
     }
 
+    publish_image_identity();
+
+    if (tftf.crypto_state != CRYPTO_STATE_VERIFIED &&
+        tftf.contain_signature) {
+        /**
+         * this image contains signature blocks
+         * but none of them were able to verify the data
+         * so this image is corrupted
+         */
+        *is_secure_image = 0;
+        set_last_error(BRE_TFTF_IMAGE_CORRUPTED);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Copy the identity of the loaded image into the communication area
+ */
+static void publish_image_identity(void) {
     communication_area *p = (communication_area *)&_communication_area;
 
     /* compiler hack to verify the two arrays have the same size */
@@ -295,24 +368,173 @@ int load_tftf_image(data_load_ops *ops, uint32_t *is_secure_image) {
     memcpy(p->firmware_package_name,
            tftf.header.firmware_package_name,
            sizeof(p->firmware_package_name));
+}
 
-    if (tftf.crypto_state != CRYPTO_STATE_VERIFIED &&
-        tftf.contain_signature) {
-        /**
-         * this image contains signature blocks
-         * but none of them were able to verify the data
-         * so this image is corrupted
+#ifdef CONFIG_WARM_BOOT
+/**
+ * @brief Arm the warm-boot record for the image about to be started
+ *
+ * Only an image whose signature verified and whose hashed data all stays
+ * resident in workram can be warm-booted; for any other image the record is
+ * left disarmed.
+ */
+void tftf_arm_warm_boot(void) {
+    disarm_warm_boot();
+
+    if (tftf.crypto_state != CRYPTO_STATE_VERIFIED || !tftf.resident) {
+        return;
+    }
+
+    memcpy(&warm_boot->header, &tftf.header, sizeof(warm_boot->header));
+    memcpy(warm_boot->digest, tftf.hash, sizeof(warm_boot->digest));
+    warm_boot->marker = WARM_BOOT_MARKER;
+    warm_boot->marker_complement = ~WARM_BOOT_MARKER;
+}
+
+static bool is_resident_section(tftf_section_descriptor *section) {
+    return section->section_type < TFTF_SECTION_SIGNATURE &&
+           section->section_load_address != DATA_ADDRESS_TO_BE_IGNORED;
+}
+
+/**
+ * @brief Zero the image area outside the loaded section data
+ *
+ * Leaves workram as a cold boot would have: zero everywhere except for the
+ * section data, including the expanded tails of the sections.
+ */
+static void clear_around_sections(tftf_header *header) {
+    uint32_t cursor = (uintptr_t)&_workram_start;
+    uint32_t limit = (uintptr_t)&_bootrom_data_area;
+    tftf_section_descriptor *section;
+    tftf_section_descriptor *next;
+
+    while (cursor < limit) {
+        /*
+         * Find the lowest section at or above the cursor. A section with
+         * nothing to keep would not move the cursor, so it is skipped.
          */
-        *is_secure_image = 0;
-        set_last_error(BRE_TFTF_IMAGE_CORRUPTED);
+        next = NULL;
+        for (section = &header->sections[0];
+             section < &header->sections[TFTF_MAX_SECTIONS] &&
+             section->section_type != TFTF_SECTION_END;
+             section++) {
+            if (is_resident_section(section) &&
+                section->section_expanded_length != 0 &&
+                section->section_load_address >= cursor &&
+                (next == NULL ||
+                 section->section_load_address < next->section_load_address)) {
+                next = section;
+            }
+        }
+        if (next == NULL) {
+            memset((void *)(uintptr_t)cursor, 0, limit - cursor);
+            return;
+        }
+
+        memset((void *)(uintptr_t)cursor, 0,
+               next->section_load_address - cursor);
+        cursor = next->section_load_address + next->section_length;
+        memset((void *)(uintptr_t)cursor, 0,
+               next->section_expanded_length - next->section_length);
+        cursor = next->section_load_address + next->section_expanded_length;
+    }
+}
+
+/**
+ * @brief Check whether the image recorded before a warm reset is still intact
+ *
+ * Re-hashes the recorded header and the section data as it sits in workram,
+ * and requires that the digest matches the recorded one, that the recorded
+ * signature verifies it and that the image is for this chip, as a cold boot
+ * would. Nothing else in the record is trusted. The record is consumed
+ * either way. If it fails, the image area is cleared, since boot.S left it
+ * alone.
+ *
+ * @param boot_status Set to the boot status for a trusted warm boot
+ *
+ * @returns 0 if the image can be started with jump_to_image(), -1 otherwise
+ */
+int tftf_warm_boot(uint32_t *boot_status) {
+    tftf_section_descriptor *section;
+    unsigned char digest[HASH_DIGEST_SIZE];
+    bool ram_kept;
+    int rc;
+
+    /* boot.S keeps workram whenever the complement matches */
+    ram_kept = (warm_boot->marker == ~warm_boot->marker_complement);
+    if (!ram_kept) {
         return -1;
     }
+    if (warm_boot->marker != WARM_BOOT_MARKER) {
+        goto stale;
+    }
+    warm_boot->marker = 0;
+    warm_boot->marker_complement = 0;
+
+    memcpy(&tftf.header, &warm_boot->header, sizeof(tftf.header));
+    if (!valid_tftf_header(&tftf.header) ||
+        check_tftf_vid_pid(&tftf.header)) {
+        goto stale;
+    }
+
+    /* Hash exactly what load_tftf_header() and process_tftf_section() did */
+    section = &tftf.header.sections[0];
+    while (section->section_type < TFTF_SECTION_SIGNATURE) {
+        section++;
+    }
+    if (section->section_type == TFTF_SECTION_END) {
+        goto stale;
+    }
+    hash_start();
+    hash_update((unsigned char *)&tftf.header,
+                (unsigned char *)section - (unsigned char *)&tftf.header);
+    for (section = &tftf.header.sections[0];
+         section->section_type < TFTF_SECTION_SIGNATURE;
+         section++) {
+        if (!is_resident_section(section)) {
+            goto stale;
+        }
+        hash_update((unsigned char *)(uintptr_t)section->section_load_address,
+                    section->section_length);
+    }
+    hash_final(digest);
 
+    if (memcmp(digest, warm_boot->digest, sizeof(digest)) != 0) {
+        goto stale;
+    }
+    timeline_begin(BOOT_PHASE_RSA_VERIFY, section - tftf.header.sections);
+    rc = verify_signature(digest, &warm_boot->signature);
+    timeline_end(BOOT_PHASE_RSA_VERIFY, section - tftf.header.sections);
+    if (rc != 0) {
+        goto stale;
+    }
+
+    clear_around_sections(&tftf.header);
+    publish_image_identity();
+    /* Only a verified image gets here */
+    *boot_status = INIT_STATUS_TRUSTED_WARM_BOOT_FINISHED;
+    dbgprint("Warm boot\n");
     return 0;
+
+stale:
+    disarm_warm_boot();
+    memset(&_workram_start, 0, &_bootrom_data_area - &_workram_start);
+    /* Don't let the failed check show up as the cause of a later failure */
+    init_last_error();
+    return -1;
 }
+#endif /* CONFIG_WARM_BOOT */
 
 void jump_to_image(void) {
+    timeline_begin(BOOT_PHASE_CPORT_RESET, 0);
     chip_reset_before_jump();
+    timeline_end(BOOT_PHASE_CPORT_RESET, 0);
+    timeline_publish();
+    timeline_begin(BOOT_PHASE_JUMP, 0);
+    chip_profile_stop();
+    chip_profile_report();
+    trace_event(TRACE_EVENT_JUMP, 0, tftf.header.start_location, 0);
+    trace_drain();
     dbgflush();
     chip_jump_to_image(tftf.header.start_location);
 }
@@ -383,7 +605,7 @@ bool valid_tftf_section(tftf_section_descriptor * section,
     }
 
     /* can this section fit into the system memory */
-    if (chip_validate_data_load_location((void *)section_start,
+    if (chip_validate_data_load_location((void *)(uintptr_t)section_start,
                                          section->section_expanded_length)) {
         set_last_error(BRE_TFTF_MEMORY_RANGE);
         return false;
@@ -475,7 +697,7 @@ bool valid_tftf_header(tftf_header * header) {
      * descriptors and the padding) is zero-filled
      */
     if (!is_constant_fill((uint8_t *)section,
-                          (uint32_t)&header[1] - (uint32_t)section,
+                          (uint8_t *)&header[1] - (uint8_t *)section,
                           0x00)) {
         set_last_error(BRE_TFTF_NON_ZERO_PAD);
         return false;
@@ -0,0 +1,92 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "bootrom.h"
+#include "chipapi.h"
+#include "timeline.h"
+
+static boot_timeline * const timeline =
+    &((communication_area *)&_communication_area)->timeline;
+
+void timeline_init(void) {
+#if BOOT_STAGE == 1
+    memset(timeline, 0, sizeof(*timeline));
+#endif
+}
+
+static void timeline_log(boot_phase phase, uint8_t type, uint16_t arg) {
+    timeline_event *event;
+    uint32_t cycles = chip_cycle_count();
+
+    /* Keep counting once the table is full, so the overflow is visible */
+    if (timeline->count < TIMELINE_MAX_EVENTS) {
+        event = &timeline->events[timeline->count];
+        event->phase = phase;
+        event->type = type;
+        event->arg = arg;
+        event->cycles = cycles;
+    }
+    timeline->count++;
+
+#if defined(_SIMULATION) && ((BOOT_STAGE == 1) || (BOOT_STAGE == 3))
+    chip_phase_marker(phase, type);
+#endif
+}
+
+void timeline_begin(boot_phase phase, uint16_t arg) {
+    timeline_log(phase, TIMELINE_EVENT_BEGIN, arg);
+}
+
+void timeline_end(boot_phase phase, uint16_t arg) {
+    timeline_log(phase, TIMELINE_EVENT_END, arg);
+}
+
+void timeline_count(boot_counter counter, uint32_t n) {
+    timeline->counters[counter] += n;
+}
+
+void timeline_set_boot_source(uint32_t source) {
+    timeline->boot_source = source;
+}
+
+void timeline_publish(void) {
+    uint32_t metrics[NUMBER_OF_BOOT_METRICS];
+    unsigned int i;
+
+    metrics[BOOT_METRICS_HEADER] = (BOOT_METRICS_VERSION << 24) |
+                                   ((timeline->boot_source & 0xFF) << 16);
+    metrics[BOOT_METRICS_TOTAL_CYCLES] = chip_cycle_count();
+    for (i = 0; i < NUMBER_OF_BOOT_COUNTERS; i++) {
+        metrics[BOOT_METRICS_COUNTERS + i] = timeline->counters[i];
+    }
+
+    chip_advertise_boot_metrics(metrics, NUMBER_OF_BOOT_METRICS);
+}
@@ -0,0 +1,116 @@
+/**
+ * Copyright (c) 2015 Google Inc.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from this
+ * software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "bootrom.h"
+#include "chipapi.h"
+#include "trace.h"
+
+#ifdef _TRACE
+
+/* Must be a power of 2 */
+#define TRACE_RING_RECORDS  64
+
+/* trace_dump() takes its records from the ring */
+typedef char ___trace_dump_test[(TRACE_DUMP_RECORDS <= TRACE_RING_RECORDS) ?
+                                1 : -1];
+
+static trace_record ring[TRACE_RING_RECORDS];
+/* Free-running counts, so head - tail is the number of records pending */
+static uint32_t head;
+static uint32_t tail;
+
+static trace_dump_area * const dump =
+    &((communication_area *)&_communication_area)->trace;
+
+void trace_init(void) {
+    head = 0;
+    tail = 0;
+#if BOOT_STAGE == 1
+    memset(dump, 0, sizeof(*dump));
+#endif
+}
+
+void trace_event(trace_event_id id, uint16_t arg0, uint32_t arg1,
+                 uint32_t arg2) {
+    trace_record *record = &ring[head & (TRACE_RING_RECORDS - 1)];
+
+    /* Drop the oldest pending record rather than the newest */
+    if (head - tail == TRACE_RING_RECORDS) {
+        tail++;
+    }
+
+    record->magic = TRACE_RECORD_MAGIC;
+    record->id = id;
+    record->arg0 = arg0;
+    record->cycles = chip_cycle_count();
+    record->arg1 = arg1;
+    record->arg2 = arg2;
+    head++;
+}
+
+void trace_poll(void) {
+#ifdef _DEBUG
+    /* Whole records only, so no debug text lands in the middle of one */
+    while (tail != head) {
+        if (chip_dbgtrywrite(
+                (const uint8_t *)&ring[tail & (TRACE_RING_RECORDS - 1)],
+                sizeof(trace_record)) == 0) {
+            /* The UART is busy; carry on with the boot */
+            return;
+        }
+        tail++;
+    }
+#endif
+}
+
+void trace_drain(void) {
+#ifdef _DEBUG
+    while (tail != head) {
+        trace_poll();
+    }
+    chip_dbgflush();
+#endif
+}
+
+void trace_dump(void) {
+    uint32_t n = (head < TRACE_DUMP_RECORDS) ? head : TRACE_DUMP_RECORDS;
+    uint32_t i;
+
+    /* Records stay in the ring after they are sent, until overwritten */
+    for (i = 0; i < n; i++) {
+        memcpy(&dump->records[i],
+               &ring[(head - n + i) & (TRACE_RING_RECORDS - 1)],
+               sizeof(trace_record));
+    }
+    dump->count = head;
+}
+
+#endif /* _TRACE */
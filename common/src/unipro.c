@@ -36,6 +36,8 @@
 #include "data_loading.h"
 #include "unipro.h"
 #include "greybus.h"
+#include "capture.h"
+#include "timeline.h"
 #include "utils.h"
 
 /**
@@ -44,7 +46,7 @@
  */
 int read_mailbox(uint32_t *val) {
     int rc;
-    uint32_t mbox = TSB_MAIL_RESET, irq_status;
+    uint32_t mbox = TSB_MAIL_RESET;
 
     if (!val) {
         return -EINVAL;
@@ -57,10 +59,9 @@ int read_mailbox(uint32_t *val) {
      * is meant to arrive to the point of reading/writing the mailbox and wait
      * for a notification from the SVC (supervisory controller).
      */
-    do {
-        rc = chip_unipro_attr_read(TSB_INTERRUPTSTATUS, &irq_status, 0,
-                                   ATTR_LOCAL);
-    } while (!rc && !(irq_status & TSB_INTERRUPTSTATUS_MAILBOX));
+    rc = chip_unipro_attr_wait(TSB_INTERRUPTSTATUS, 0, ATTR_LOCAL,
+                               TSB_INTERRUPTSTATUS_MAILBOX, 0, UNIPRO_WAIT_NE,
+                               NULL);
     if (rc) {
         return rc;
     }
@@ -76,6 +77,7 @@ int read_mailbox(uint32_t *val) {
     }
 
     *val = mbox;
+    capture_message(CAPTURE_MAILBOX_RX, mbox, NULL, 0);
 
     return 0;
 }
@@ -95,8 +97,8 @@ int ack_mailbox(uint16_t val) {
  */
 int write_mailbox(uint32_t val) {
     int rc;
-    uint32_t irq_status = 0;
 
+    capture_message(CAPTURE_MAILBOX_TX, val, NULL, 0);
     rc = chip_unipro_attr_write(TSB_MAILBOX, val, 0, ATTR_PEER);
     if (rc) {
         return rc;
@@ -106,12 +108,43 @@ int write_mailbox(uint32_t val) {
      * picked up our mail.  This is a synchronous barrier operation, so no
      * timeout has been included.
      */
-    do {
-        rc = chip_unipro_attr_read(TSB_INTERRUPTSTATUS, &irq_status, 0,
-                                   ATTR_PEER);
-    } while (!rc && (irq_status & TSB_INTERRUPTSTATUS_MAILBOX));
+    return chip_unipro_attr_wait(TSB_INTERRUPTSTATUS, 0, ATTR_PEER,
+                                 TSB_INTERRUPTSTATUS_MAILBOX, 0,
+                                 UNIPRO_WAIT_EQ, NULL);
+}
+
+/* How far we've got towards advertising readiness */
+enum {
+    READY_LINK_DOWN,
+    READY_LINK_UP,
+    READY_PREPARED,
+};
+static int ready_state = READY_LINK_DOWN;
+
+/**
+ * @brief Advance readiness as far as possible without blocking
+ *
+ * Checks the link state once and, when the link is up, prepares the CPorts
+ * for the switch, so that a later advertise_ready() only has the mailbox
+ * handshake left to do. Meant to be called from between the steps of
+ * another boot method.
+ */
+void unipro_ready_poll(void) {
+    uint32_t powerstate;
 
-    return rc;
+    if (ready_state == READY_LINK_DOWN) {
+        if (chip_unipro_attr_read(TSB_POWERSTATE, &powerstate, 0,
+                                  ATTR_LOCAL) ||
+            powerstate != POWERSTATE_LINKUP) {
+            return;
+        }
+        ready_state = READY_LINK_UP;
+    }
+
+    if (ready_state == READY_LINK_UP) {
+        chip_reset_before_ready();
+        ready_state = READY_PREPARED;
+    }
 }
 
 /**
@@ -121,12 +154,18 @@ int advertise_ready(void) {
     int rc;
 
     /**
-     * This should be the first time need to talk to the peer,
-     * so need to wait for link up
+     * Unless unipro_ready_poll() has already seen it, this is the first time
+     * we need to talk to the peer, so need to wait for link up
      */
-    chip_wait_for_link_up();
+    if (ready_state == READY_LINK_DOWN) {
+        chip_wait_for_link_up();
+        ready_state = READY_LINK_UP;
+    }
 
-    chip_reset_before_ready();
+    if (ready_state == READY_LINK_UP) {
+        chip_reset_before_ready();
+        ready_state = READY_PREPARED;
+    }
 
     /**
      * Write that we're a ready non-AP module to the switch's mailbox
@@ -140,3 +179,146 @@ int advertise_ready(void) {
     dbgprint("Module ready advertised.\n");
     return 0;
 }
+
+/* The PA_* attributes a power mode change touches, in the order we set them */
+enum {
+    PMC_TXGEAR,
+    PMC_TXTERMINATION,
+    PMC_HSSERIES,
+    PMC_ACTIVETXDATALANES,
+    PMC_RXGEAR,
+    PMC_RXTERMINATION,
+    PMC_ACTIVERXDATALANES,
+    PMC_NUM_ATTRS
+};
+
+static const uint16_t pmc_attrs[PMC_NUM_ATTRS] = {
+    [PMC_TXGEAR]            = PA_TXGEAR,
+    [PMC_TXTERMINATION]     = PA_TXTERMINATION,
+    [PMC_HSSERIES]          = PA_HSSERIES,
+    [PMC_ACTIVETXDATALANES] = PA_ACTIVETXDATALANES,
+    [PMC_RXGEAR]            = PA_RXGEAR,
+    [PMC_RXTERMINATION]     = PA_RXTERMINATION,
+    [PMC_ACTIVERXDATALANES] = PA_ACTIVERXDATALANES,
+};
+
+static void pmc_fill(struct unipro_attr_req *reqs, const uint32_t *vals,
+                     int write) {
+    unsigned int i;
+
+    for (i = 0; i < PMC_NUM_ATTRS; i++) {
+        reqs[i].attr = pmc_attrs[i];
+        reqs[i].selector = 0;
+        reqs[i].val = write ? vals[i] : 0;
+        reqs[i].peer = ATTR_LOCAL;
+        reqs[i].write = write;
+    }
+}
+
+/**
+ * @brief Request one power mode change and wait for its outcome
+ * @return the DME_POWERMODEIND value, or 0 if it could not be requested
+ */
+static uint32_t request_power_mode(const uint32_t *vals, uint32_t mode) {
+    struct unipro_attr_req reqs[1 + PMC_NUM_ATTRS + 1];
+    uint32_t ind;
+
+    /*
+     * DME_POWERMODEIND holds the outcome of the last request until it is
+     * read. Read it first, so that the wait below can't mistake the outcome
+     * of an earlier request, the one that failed before a retry in a lower
+     * gear for instance, for that of this one.
+     */
+    reqs[0].attr = DME_POWERMODEIND;
+    reqs[0].selector = 0;
+    reqs[0].val = 0;
+    reqs[0].peer = ATTR_LOCAL;
+    reqs[0].write = 0;
+    pmc_fill(&reqs[1], vals, 1);
+    reqs[1 + PMC_NUM_ATTRS].attr = PA_PWRMODE;
+    reqs[1 + PMC_NUM_ATTRS].selector = 0;
+    reqs[1 + PMC_NUM_ATTRS].val = mode;
+    reqs[1 + PMC_NUM_ATTRS].peer = ATTR_LOCAL;
+    reqs[1 + PMC_NUM_ATTRS].write = 1;
+
+    if (chip_unipro_attr_access_batch(reqs, ARRAY_SIZE(reqs))) {
+        return 0;
+    }
+
+    if (chip_unipro_attr_wait(DME_POWERMODEIND, 0, ATTR_LOCAL, 0xFFFFFFFF,
+                              DME_POWERMODEIND_NONE, UNIPRO_WAIT_NE, &ind)) {
+        return 0;
+    }
+
+    return ind;
+}
+
+int unipro_change_power_mode(uint32_t gear, uint32_t series) {
+    struct unipro_attr_req caps[] = {
+        UNIPRO_ATTR_READ(PA_MAXRXHSGEAR, 0, ATTR_LOCAL),
+        UNIPRO_ATTR_READ(PA_MAXRXHSGEAR, 0, ATTR_PEER),
+        UNIPRO_ATTR_READ(PA_CONNECTEDTXDATALANES, 0, ATTR_LOCAL),
+        UNIPRO_ATTR_READ(PA_CONNECTEDRXDATALANES, 0, ATTR_LOCAL),
+    };
+    struct unipro_attr_req saved[PMC_NUM_ATTRS];
+    uint32_t vals[PMC_NUM_ATTRS];
+    uint32_t max_tx_gear, max_rx_gear;
+    uint32_t ind = 0;
+    unsigned int i;
+    int rc;
+
+    pmc_fill(saved, NULL, 0);
+    rc = chip_unipro_attr_access_batch(saved, ARRAY_SIZE(saved));
+    if (!rc) {
+        rc = chip_unipro_attr_access_batch(caps, ARRAY_SIZE(caps));
+    }
+    if (rc) {
+        dbgprintx32("PMC: can't read link capabilities: ", rc, "\n");
+        return rc;
+    }
+
+    /* We transmit into the peer's receiver, and receive with our own */
+    max_tx_gear = caps[1].val;
+    max_rx_gear = caps[0].val;
+
+    vals[PMC_TXTERMINATION] = 1;
+    vals[PMC_RXTERMINATION] = 1;
+    vals[PMC_HSSERIES] = series;
+    vals[PMC_ACTIVETXDATALANES] = caps[2].val;
+    vals[PMC_ACTIVERXDATALANES] = caps[3].val;
+
+    for (; gear > 0; gear--) {
+        vals[PMC_TXGEAR] = gear < max_tx_gear ? gear : max_tx_gear;
+        vals[PMC_RXGEAR] = gear < max_rx_gear ? gear : max_rx_gear;
+        if (!vals[PMC_TXGEAR] || !vals[PMC_RXGEAR]) {
+            break;
+        }
+
+        ind = request_power_mode(vals,
+                                 PA_PWRMODE_RX(PA_FAST_MODE) |
+                                 PA_PWRMODE_TX(PA_FAST_MODE));
+        if (ind == DME_POWERMODEIND_OK) {
+            dbgprintx32("PMC: link now in HS gear ", vals[PMC_TXGEAR], "\n");
+            return 0;
+        }
+        if (ind != DME_POWERMODEIND_CAP_ERR) {
+            break;
+        }
+        /* The gear we asked for can't be reached, try the next one down */
+        timeline_count(BOOT_COUNTER_RETRIES, 1);
+        gear = vals[PMC_TXGEAR] > vals[PMC_RXGEAR] ?
+               vals[PMC_TXGEAR] : vals[PMC_RXGEAR];
+    }
+
+    /*
+     * A failed request leaves the link in the mode it was in. Put the
+     * attributes back too, so that they keep describing that mode.
+     */
+    for (i = 0; i < PMC_NUM_ATTRS; i++) {
+        saved[i].write = 1;
+    }
+    chip_unipro_attr_access_batch(saved, ARRAY_SIZE(saved));
+
+    dbgprintx32("PMC: staying in the current mode, ind: ", ind, "\n");
+    return ind ? ind : -EIO;
+}
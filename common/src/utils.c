@@ -64,6 +64,19 @@ void *memset(void *s, int c, size_t n) {
     return s;
 }
 
+int memcmp(const void *s1, const void *s2, size_t n) {
+    size_t i;
+    const unsigned char *p1 = (const unsigned char*)s1;
+    const unsigned char *p2 = (const unsigned char*)s2;
+
+    for (i = 0; i < n; i++) {
+        if (p1[i] != p2[i]) {
+            return p1[i] - p2[i];
+        }
+    }
+    return 0;
+}
+
 /**
  * @brief Determine if a value is a power of 2
  *